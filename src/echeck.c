@@ -396,25 +396,106 @@ char echeck_status_m(struct eembed_log *err, const char *func, const char *file,
 	return c;
 }
 
+#if Echeck_use_atomic_counters
+#define echeck_counter_get(counter) \
+	__atomic_load_n(&(counter), __ATOMIC_SEQ_CST)
+
+#define echeck_counter_add(counter, n) \
+	__atomic_add_fetch(&(counter), n, __ATOMIC_SEQ_CST)
+
+#define echeck_counter_post_inc(counter) \
+	__atomic_fetch_add(&(counter), 1, __ATOMIC_SEQ_CST)
+#else
+#define echeck_counter_get(counter) (counter)
+#define echeck_counter_add(counter, n) ((counter) += (n))
+#define echeck_counter_post_inc(counter) ((counter)++)
+#endif
+
+static void echeck_counter_raise_to(unsigned long *counter, unsigned long val)
+{
+#if Echeck_use_atomic_counters
+	unsigned long cur = __atomic_load_n(counter, __ATOMIC_SEQ_CST);
+	while (val > cur
+	       && !__atomic_compare_exchange_n(counter, &cur, val, 0,
+					       __ATOMIC_SEQ_CST,
+					       __ATOMIC_SEQ_CST)) {
+		/* another thread changed the counter, cur has been reloaded */
+	}
+#else
+	if (val > *counter) {
+		*counter = val;
+	}
+#endif
+}
+
 void whine_if_context_data_corruption(struct echeck_err_injecting_context *ctx)
 {
 	struct eembed_log *log = NULL;
-	if (ctx->free_bytes > ctx->alloc_bytes) {
+	unsigned long free_bytes = 0;
+	unsigned long alloc_bytes = 0;
+
+	/* read free_bytes first, as each free is counted after its alloc */
+	free_bytes = echeck_counter_get(ctx->free_bytes);
+	alloc_bytes = echeck_counter_get(ctx->alloc_bytes);
+	if (free_bytes > alloc_bytes) {
 		log = ctx->log;
 		log->append_s(log, __FILE__);
 		log->append_s(log, ":");
 		log->append_ul(log, __LINE__);
 		log->append_s(log, " BAD MOJO: ");
 		log->append_s(log, " free_bytes > alloc_bytes?! (");
-		log->append_ul(log, ctx->free_bytes);
+		log->append_ul(log, free_bytes);
 		log->append_s(log, " > ");
-		log->append_ul(log, ctx->alloc_bytes);
+		log->append_ul(log, alloc_bytes);
 		log->append_s(log, ")");
 		log->append_s(log, " CONTEXT DATA CORRUPTION!");
 		log->append_eol(log);
 	}
 }
 
+static unsigned long echeck_err_injecting_used(struct
+					       echeck_err_injecting_context
+					       *ctx)
+{
+	/* read free_bytes first, as each free is counted after its alloc */
+	unsigned long free_bytes = echeck_counter_get(ctx->free_bytes);
+	unsigned long alloc_bytes = echeck_counter_get(ctx->alloc_bytes);
+	return alloc_bytes - free_bytes;
+}
+
+static void echeck_err_injecting_sample(struct echeck_err_injecting_context
+					*ctx, unsigned long attempts,
+					unsigned long used)
+{
+	struct echeck_err_injecting_sample *sample = NULL;
+	unsigned long granularity = 0;
+	size_t pos = 0;
+
+	if (!ctx->timeline || !ctx->timeline_len) {
+		return;
+	}
+
+	granularity = ctx->timeline_granularity;
+	if (ctx->timeline_count) {
+		pos = (ctx->timeline_count - 1) % ctx->timeline_len;
+		sample = ctx->timeline + pos;
+		if ((sample->attempts / granularity) ==
+		    (attempts / granularity)) {
+			if (used > sample->used) {
+				sample->attempts = attempts;
+				sample->used = used;
+			}
+			return;
+		}
+	}
+
+	pos = ctx->timeline_count % ctx->timeline_len;
+	sample = ctx->timeline + pos;
+	sample->attempts = attempts;
+	sample->used = used;
+	++ctx->timeline_count;
+}
+
 void *echeck_err_injecting_malloc(struct eembed_allocator *ea, size_t size)
 {
 	struct eembed_allocator *real;
@@ -422,30 +503,34 @@ void *echeck_err_injecting_malloc(struct eembed_allocator *ea, size_t size)
 	unsigned char *tracking_buffer = NULL;
 	void *ptr = NULL;
 	size_t wide = 0;
-	size_t used = 0;
+	unsigned long attempt = 0;
+	unsigned long used = 0;
 
 	ctx = (struct echeck_err_injecting_context *)ea->context;
-	if (0x01 & (ctx->attempts_to_fail_bitmask >> ctx->attempts++)) {
+	attempt = echeck_counter_post_inc(ctx->attempts);
+	/* only the first attempts have a bit, a wider shift is undefined */
+	if ((attempt < (sizeof(unsigned long) * EEMBED_CHAR_BIT))
+	    && (0x01 & (ctx->attempts_to_fail_bitmask >> attempt))) {
 		return NULL;
 	}
 	real = ctx->real;
 	wide = sizeof(size_t) + size;
 	tracking_buffer = (unsigned char *)real->malloc(real, wide);
 	if (!tracking_buffer) {
-		++ctx->fails;
+		echeck_counter_add(ctx->fails, 1);
 		return NULL;
 	}
 
 	eembed_memcpy(tracking_buffer, &size, sizeof(size_t));
-	++ctx->allocs;
-	ctx->alloc_bytes += size;
+	echeck_counter_add(ctx->allocs, 1);
+	echeck_counter_add(ctx->alloc_bytes, size);
 
 	whine_if_context_data_corruption(ctx);
 
-	used = ctx->alloc_bytes - ctx->free_bytes;
-	if (used > ctx->max_used) {
-		ctx->max_used = used;
-	}
+	used = echeck_err_injecting_used(ctx);
+	echeck_counter_raise_to(&ctx->max_used, used);
+	echeck_err_injecting_sample(ctx, attempt + 1, used);
+
 	ptr = (void *)(tracking_buffer + sizeof(size_t));
 	return ptr;
 }
@@ -506,7 +591,7 @@ void echeck_err_injecting_free(struct eembed_allocator *ea, void *ptr)
 	ctx = (struct echeck_err_injecting_context *)ea->context;
 
 	if (ptr == NULL) {
-		++ctx->fails;
+		echeck_counter_add(ctx->fails, 1);
 		return;
 	}
 
@@ -516,10 +601,13 @@ void echeck_err_injecting_free(struct eembed_allocator *ea, void *ptr)
 	real = ctx->real;
 	real->free(real, tracking_buffer);
 
-	ctx->free_bytes += size;
-	++ctx->frees;
+	echeck_counter_add(ctx->free_bytes, size);
+	echeck_counter_add(ctx->frees, 1);
 
 	whine_if_context_data_corruption(ctx);
+
+	echeck_err_injecting_sample(ctx, echeck_counter_get(ctx->attempts),
+				    echeck_err_injecting_used(ctx));
 }
 
 void echeck_err_injecting_allocator_init(struct eembed_allocator *with_errs,
@@ -544,3 +632,352 @@ void echeck_err_injecting_allocator_init(struct eembed_allocator *with_errs,
 	with_errs->reallocarray = echeck_err_injecting_reallocarray;
 	with_errs->free = echeck_err_injecting_free;
 }
+
+void echeck_err_injecting_timeline_init(struct echeck_err_injecting_context *c,
+					struct echeck_err_injecting_sample
+					*samples, size_t samples_len,
+					unsigned long granularity)
+{
+	eembed_assert(c);
+
+	c->timeline = samples;
+	c->timeline_len = samples ? samples_len : 0;
+	c->timeline_count = 0;
+	c->timeline_granularity = granularity ? granularity : 1;
+}
+
+void echeck_err_injecting_timeline_csv(struct eembed_log *log,
+				       struct echeck_err_injecting_context *c)
+{
+	struct echeck_err_injecting_sample *sample = NULL;
+	size_t i = 0;
+
+	eembed_assert(log);
+	eembed_assert(c);
+
+	log->append_s(log, "attempts,used");
+	log->append_eol(log);
+
+	if (!c->timeline_len) {
+		return;
+	}
+
+	i = (c->timeline_count > c->timeline_len)
+	    ? (c->timeline_count - c->timeline_len) : 0;
+	for (; i < c->timeline_count; ++i) {
+		sample = c->timeline + (i % c->timeline_len);
+		log->append_ul(log, sample->attempts);
+		log->append_c(log, ',');
+		log->append_ul(log, sample->used);
+		log->append_eol(log);
+	}
+}
+
+unsigned char echeck_alloc_budget_m(struct eembed_log *err, const char *func,
+				    const char *file, int line,
+				    const char *counter, unsigned long actual,
+				    unsigned long at_most, const char *msg)
+{
+	if (actual <= at_most) {
+		return 0;
+	}
+
+	err = echeck_ensure_log(err);
+
+	echeck_append_fail(err, msg);
+	err->append_s(err, " Expected ");
+	err->append_s(err, counter);
+	err->append_s(err, " at most ");
+	err->append_ul(err, at_most);
+	err->append_s(err, " but was ");
+	err->append_ul(err, actual);
+	err->append_s(err, " ");
+	echeck_append_func_file_line(err, func, file, line);
+	err->append_eol(err);
+
+	return 1;
+}
+
+#ifdef delay_ms_u16
+void echeck_latency_sleep_ms(unsigned long milliseconds)
+{
+	uint16_t chunk = 0;
+
+	while (milliseconds) {
+		chunk = (milliseconds > UINT16_MAX) ? UINT16_MAX : milliseconds;
+		delay_ms_u16(chunk);
+		milliseconds -= chunk;
+	}
+}
+#endif
+
+void echeck_latency_spin(unsigned long iterations)
+{
+	volatile unsigned long i = 0;
+
+	for (i = 0; i < iterations; ++i) {
+		/* burn a few cycles */
+	}
+}
+
+void echeck_latency_spin_ms(unsigned long milliseconds)
+{
+	/* one millisecond at a time, the product could overflow */
+	while (milliseconds--) {
+		echeck_latency_spin(Echeck_latency_spins_per_ms);
+	}
+}
+
+static uint32_t echeck_latency_random(struct echeck_latency_injecting_context
+				      *ctx)
+{
+	/* the constants used by eembed_lcg_pseudo_random_bytes */
+	ctx->seed = (ctx->seed * 69069) + 1;
+	/* the low bits of an LCG are not very random, use the high bits */
+	return ctx->seed >> 8;
+}
+
+static void echeck_latency_inject(struct eembed_allocator *ea)
+{
+	struct echeck_latency_injecting_context *ctx = NULL;
+	unsigned long amount = 0;
+	unsigned long span = 0;
+	uint32_t r = 0;
+
+	ctx = (struct echeck_latency_injecting_context *)ea->context;
+
+	amount = ctx->delay_min;
+	switch (ctx->distribution) {
+	case echeck_latency_uniform:
+		r = echeck_latency_random(ctx);
+		span = (ctx->delay_max > ctx->delay_min)
+		    ? (ctx->delay_max - ctx->delay_min) : 0;
+		amount += (span < ULONG_MAX) ? (r % (span + 1)) : r;
+		break;
+	case echeck_latency_heavy_tail:
+		while ((amount < ctx->delay_max)
+		       && (echeck_latency_random(ctx) & 0x800000)) {
+			if (!amount) {
+				/* doubling zero would never leave zero */
+				amount = 1;
+			} else {
+				amount = (amount > (ctx->delay_max / 2))
+				    ? ctx->delay_max : (amount * 2);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+
+	++ctx->delays;
+	ctx->delayed_total += amount;
+	if (amount) {
+		ctx->delay(amount);
+	}
+}
+
+void *echeck_latency_injecting_malloc(struct eembed_allocator *ea, size_t size)
+{
+	struct echeck_latency_injecting_context *ctx = NULL;
+
+	ctx = (struct echeck_latency_injecting_context *)ea->context;
+	echeck_latency_inject(ea);
+	return ctx->real->malloc(ctx->real, size);
+}
+
+void *echeck_latency_injecting_calloc(struct eembed_allocator *ea,
+				      size_t nmemb, size_t size)
+{
+	struct echeck_latency_injecting_context *ctx = NULL;
+
+	ctx = (struct echeck_latency_injecting_context *)ea->context;
+	echeck_latency_inject(ea);
+	return ctx->real->calloc(ctx->real, nmemb, size);
+}
+
+void *echeck_latency_injecting_realloc(struct eembed_allocator *ea, void *ptr,
+				       size_t size)
+{
+	struct echeck_latency_injecting_context *ctx = NULL;
+
+	ctx = (struct echeck_latency_injecting_context *)ea->context;
+	echeck_latency_inject(ea);
+	return ctx->real->realloc(ctx->real, ptr, size);
+}
+
+void *echeck_latency_injecting_reallocarray(struct eembed_allocator *ea,
+					    void *ptr, size_t nmemb,
+					    size_t size)
+{
+	struct echeck_latency_injecting_context *ctx = NULL;
+
+	ctx = (struct echeck_latency_injecting_context *)ea->context;
+	echeck_latency_inject(ea);
+	return ctx->real->reallocarray(ctx->real, ptr, nmemb, size);
+}
+
+void echeck_latency_injecting_free(struct eembed_allocator *ea, void *ptr)
+{
+	struct echeck_latency_injecting_context *ctx = NULL;
+
+	ctx = (struct echeck_latency_injecting_context *)ea->context;
+	echeck_latency_inject(ea);
+	ctx->real->free(ctx->real, ptr);
+}
+
+void echeck_latency_injecting_allocator_init(struct eembed_allocator *slow,
+					     struct eembed_allocator *real,
+					     struct
+					     echeck_latency_injecting_context
+					     *c)
+{
+	eembed_assert(slow);
+	eembed_assert(real);
+	eembed_assert(c);
+
+	eembed_memset(c, 0x00, sizeof(struct echeck_latency_injecting_context));
+	c->distribution = echeck_latency_fixed;
+	c->seed = 1;
+#ifdef delay_ms_u16
+	c->delay = echeck_latency_sleep_ms;
+#else
+	c->delay = echeck_latency_spin_ms;
+#endif
+	c->real = real;
+
+	slow->context = c;
+
+	slow->malloc = echeck_latency_injecting_malloc;
+	slow->calloc = echeck_latency_injecting_calloc;
+	slow->realloc = echeck_latency_injecting_realloc;
+	slow->reallocarray = echeck_latency_injecting_reallocarray;
+	slow->free = echeck_latency_injecting_free;
+}
+
+struct echeck_no_alloc_context {
+	struct eembed_allocator *prev;
+	struct eembed_log *err;
+	const char *func;
+	const char *file;
+	int line;
+	unsigned long allocs;
+};
+
+static struct echeck_no_alloc_context echeck_no_alloc_ctx;
+
+static struct eembed_allocator *echeck_no_alloc_trap(const char *call,
+						     size_t size)
+{
+	struct echeck_no_alloc_context *ctx = &echeck_no_alloc_ctx;
+	struct eembed_log *err = echeck_ensure_log(ctx->err);
+
+	++ctx->allocs;
+
+	echeck_append_fail(err, "no_alloc");
+	err->append_s(err, " unexpected ");
+	err->append_s(err, call);
+	err->append_s(err, "(");
+	err->append_ul(err, size);
+	err->append_s(err, ")");
+	if (eembed_alloc_site.file) {
+		err->append_s(err, " at ");
+		err->append_s(err, eembed_alloc_site.file);
+		err->append_s(err, ":");
+		err->append_l(err, eembed_alloc_site.line);
+	}
+	if (eembed_alloc_site.caller) {
+		err->append_s(err, " called from ");
+		err->append_vp(err, eembed_alloc_site.caller);
+	}
+	err->append_s(err, " in region begun ");
+	echeck_append_func_file_line(err, ctx->func, ctx->file, ctx->line);
+	err->append_eol(err);
+
+	return ctx->prev;
+}
+
+static void *echeck_no_alloc_malloc(struct eembed_allocator *ea, size_t size)
+{
+	struct eembed_allocator *prev = NULL;
+
+	(void)ea;
+	prev = echeck_no_alloc_trap("eembed_malloc", size);
+	return prev->malloc(prev, size);
+}
+
+static void *echeck_no_alloc_calloc(struct eembed_allocator *ea, size_t nmemb,
+				    size_t size)
+{
+	struct eembed_allocator *prev = NULL;
+
+	(void)ea;
+	prev = echeck_no_alloc_trap("eembed_calloc", nmemb * size);
+	return prev->calloc(prev, nmemb, size);
+}
+
+static void *echeck_no_alloc_realloc(struct eembed_allocator *ea, void *ptr,
+				     size_t size)
+{
+	struct eembed_allocator *prev = NULL;
+
+	(void)ea;
+	prev = echeck_no_alloc_trap("eembed_realloc", size);
+	return prev->realloc(prev, ptr, size);
+}
+
+static void *echeck_no_alloc_reallocarray(struct eembed_allocator *ea,
+					  void *ptr, size_t nmemb, size_t size)
+{
+	struct eembed_allocator *prev = NULL;
+
+	(void)ea;
+	prev = echeck_no_alloc_trap("eembed_reallocarray", nmemb * size);
+	return prev->reallocarray(prev, ptr, nmemb, size);
+}
+
+static void echeck_no_alloc_free(struct eembed_allocator *ea, void *ptr)
+{
+	struct eembed_allocator *prev = echeck_no_alloc_ctx.prev;
+
+	(void)ea;
+	prev->free(prev, ptr);
+}
+
+static struct eembed_allocator echeck_no_alloc_allocator = {
+	NULL,
+	echeck_no_alloc_malloc,
+	echeck_no_alloc_calloc,
+	echeck_no_alloc_realloc,
+	echeck_no_alloc_reallocarray,
+	echeck_no_alloc_free
+};
+
+void echeck_no_alloc_begin_m(struct eembed_log *err, const char *func,
+			     const char *file, int line)
+{
+	struct echeck_no_alloc_context *ctx = &echeck_no_alloc_ctx;
+
+	eembed_assert(eembed_global_allocator != &echeck_no_alloc_allocator);
+
+	ctx->prev = eembed_global_allocator;
+	ctx->err = err;
+	ctx->func = func;
+	ctx->file = file;
+	ctx->line = line;
+	ctx->allocs = 0;
+
+	eembed_global_allocator = &echeck_no_alloc_allocator;
+}
+
+unsigned long echeck_no_alloc_end(void)
+{
+	struct echeck_no_alloc_context *ctx = &echeck_no_alloc_ctx;
+
+	eembed_assert(eembed_global_allocator == &echeck_no_alloc_allocator);
+
+	eembed_global_allocator = ctx->prev;
+	ctx->prev = NULL;
+
+	return ctx->allocs;
+}
@@ -364,6 +364,17 @@ char echeck_status_m(struct eembed_log *err, const char *func, const char *file,
 #define check_status(val)\
 	echeck_status_m(NULL, ECHECK_FUNC, __FILE__, __LINE__, val, NULL)
 
+/* In hosted builds where the compiler offers the __atomic builtins, the
+ * counters of the echeck_err_injecting_context are updated atomically, thus
+ * a single err_injecting allocator may be shared by concurrent threads. */
+#ifndef Echeck_use_atomic_counters
+#if (EEMBED_HOSTED && defined(__ATOMIC_SEQ_CST))
+#define Echeck_use_atomic_counters 1
+#else
+#define Echeck_use_atomic_counters 0
+#endif
+#endif
+
 struct echeck_err_injecting_context;
 
 void echeck_err_injecting_allocator_init(struct eembed_allocator *with_errs,
@@ -371,6 +382,11 @@ void echeck_err_injecting_allocator_init(struct eembed_allocator *with_errs,
 					 struct echeck_err_injecting_context *c,
 					 struct eembed_log *log);
 
+struct echeck_err_injecting_sample {
+	unsigned long attempts;
+	unsigned long used;
+};
+
 struct echeck_err_injecting_context {
 	unsigned long allocs;
 	unsigned long alloc_bytes;
@@ -383,8 +399,159 @@ struct echeck_err_injecting_context {
 
 	struct eembed_allocator *real;
 	struct eembed_log *log;
+
+	/* optional, see echeck_err_injecting_timeline_init */
+	struct echeck_err_injecting_sample *timeline;
+	size_t timeline_len;
+	size_t timeline_count;
+	unsigned long timeline_granularity;
+};
+
+/* Record a timeline of the bytes in use into the caller-provided ring of
+ * samples. Each sample holds the peak bytes in use over a span of
+ * "granularity" allocation attempts, along with the "attempts" count at which
+ * that peak was reached. Once the ring is full, the oldest samples are
+ * overwritten. Must be called after echeck_err_injecting_allocator_init.
+ * The timeline is not synchronized, thus not for use by concurrent threads. */
+void echeck_err_injecting_timeline_init(struct echeck_err_injecting_context *c,
+					struct echeck_err_injecting_sample
+					*samples, size_t samples_len,
+					unsigned long granularity);
+
+/* writes the retained samples, oldest first, as "attempts,used" CSV lines */
+void echeck_err_injecting_timeline_csv(struct eembed_log *log,
+				       struct echeck_err_injecting_context *c);
+
+/* check allocation budgets of an err_injecting context: the counters of the
+ * echeck_err_injecting_context must not exceed the given limits, thus an
+ * allocation regression in a hot path fails the test */
+unsigned char echeck_alloc_budget_m(struct eembed_log *err, const char *func,
+				    const char *file, int line,
+				    const char *counter, unsigned long actual,
+				    unsigned long at_most, const char *msg);
+
+#define lcheck_allocs_at_most_m(log, ctx, at_most, msg)\
+	echeck_alloc_budget_m(log, ECHECK_FUNC, __FILE__, __LINE__,\
+		"allocs", (ctx)->allocs, at_most, msg)
+
+#define check_allocs_at_most_m(ctx, at_most, msg)\
+	echeck_alloc_budget_m(NULL, ECHECK_FUNC, __FILE__, __LINE__,\
+		"allocs", (ctx)->allocs, at_most, msg)
+
+#define lcheck_allocs_at_most(log, ctx, at_most)\
+	echeck_alloc_budget_m(log, ECHECK_FUNC, __FILE__, __LINE__,\
+		"allocs", (ctx)->allocs, at_most, #ctx)
+
+#define check_allocs_at_most(ctx, at_most)\
+	echeck_alloc_budget_m(NULL, ECHECK_FUNC, __FILE__, __LINE__,\
+		"allocs", (ctx)->allocs, at_most, #ctx)
+
+#define lcheck_alloc_bytes_at_most_m(log, ctx, at_most, msg)\
+	echeck_alloc_budget_m(log, ECHECK_FUNC, __FILE__, __LINE__,\
+		"alloc_bytes", (ctx)->alloc_bytes, at_most, msg)
+
+#define check_alloc_bytes_at_most_m(ctx, at_most, msg)\
+	echeck_alloc_budget_m(NULL, ECHECK_FUNC, __FILE__, __LINE__,\
+		"alloc_bytes", (ctx)->alloc_bytes, at_most, msg)
+
+#define lcheck_alloc_bytes_at_most(log, ctx, at_most)\
+	echeck_alloc_budget_m(log, ECHECK_FUNC, __FILE__, __LINE__,\
+		"alloc_bytes", (ctx)->alloc_bytes, at_most, #ctx)
+
+#define check_alloc_bytes_at_most(ctx, at_most)\
+	echeck_alloc_budget_m(NULL, ECHECK_FUNC, __FILE__, __LINE__,\
+		"alloc_bytes", (ctx)->alloc_bytes, at_most, #ctx)
+
+#define lcheck_max_used_at_most_m(log, ctx, at_most, msg)\
+	echeck_alloc_budget_m(log, ECHECK_FUNC, __FILE__, __LINE__,\
+		"max_used", (ctx)->max_used, at_most, msg)
+
+#define check_max_used_at_most_m(ctx, at_most, msg)\
+	echeck_alloc_budget_m(NULL, ECHECK_FUNC, __FILE__, __LINE__,\
+		"max_used", (ctx)->max_used, at_most, msg)
+
+#define lcheck_max_used_at_most(log, ctx, at_most)\
+	echeck_alloc_budget_m(log, ECHECK_FUNC, __FILE__, __LINE__,\
+		"max_used", (ctx)->max_used, at_most, #ctx)
+
+#define check_max_used_at_most(ctx, at_most)\
+	echeck_alloc_budget_m(NULL, ECHECK_FUNC, __FILE__, __LINE__,\
+		"max_used", (ctx)->max_used, at_most, #ctx)
+
+/* The latency_injecting allocator forwards to the "real" allocator, but
+ * first calls the "delay" function with an amount chosen by "distribution":
+ *   echeck_latency_fixed: always delay_min
+ *   echeck_latency_uniform: uniform between delay_min and delay_max
+ *   echeck_latency_heavy_tail: delay_min doubled while a coin-flip succeeds,
+ *	thus an amount of (delay_min * 2^k) has a 1 in 2^k chance, capped at
+ *	delay_max; a delay_min of zero becomes one at the first doubling, thus
+ *	half of the amounts are zero and the rest form the tail from one
+ * The amounts are drawn from a pseudo-random sequence starting from "seed",
+ * thus a run may be reproduced by re-using the seed. The amounts are
+ * milliseconds for the default "delay", which is echeck_latency_sleep_ms,
+ * if available, otherwise echeck_latency_spin_ms; a custom "delay" may
+ * give the amounts any unit it chooses. */
+#define echeck_latency_fixed 0
+#define echeck_latency_uniform 1
+#define echeck_latency_heavy_tail 2
+
+struct echeck_latency_injecting_context {
+	unsigned char distribution;
+	unsigned long delay_min;
+	unsigned long delay_max;
+	uint32_t seed;
+	void (*delay)(unsigned long amount);
+
+	unsigned long delays;
+	unsigned long delayed_total;
+
+	struct eembed_allocator *real;
 };
 
+void echeck_latency_injecting_allocator_init(struct eembed_allocator *slow,
+					     struct eembed_allocator *real,
+					     struct
+					     echeck_latency_injecting_context
+					     *c);
+
+#ifdef delay_ms_u16
+void echeck_latency_sleep_ms(unsigned long milliseconds);
+#endif
+
+/* a busy-wait of "iterations" trips through an empty loop */
+void echeck_latency_spin(unsigned long iterations);
+
+/* trips through the empty loop of echeck_latency_spin which take about a
+ * millisecond; the default is a guess for a small microcontroller, the
+ * target may define a measured value */
+#ifndef Echeck_latency_spins_per_ms
+#define Echeck_latency_spins_per_ms 1000UL
+#endif
+
+/* a busy-wait of roughly "milliseconds", for where there is no sleep */
+void echeck_latency_spin_ms(unsigned long milliseconds);
+
+/* Installs a trapping allocator as the eembed_global_allocator until the
+ * matching echeck_no_alloc_end. Each eembed_malloc, eembed_calloc,
+ * eembed_realloc, or eembed_reallocarray within the region is counted and
+ * reported as a FAIL naming the call, where it was made (the file and line
+ * if made with eembed_malloc_at() and friends, and with GCC the address of
+ * the caller), and the site of echeck_no_alloc_begin,
+ * then forwarded to the previous allocator so that the code under test may
+ * continue; eembed_free is forwarded silently. Regions do not nest and are
+ * not for use by concurrent threads. */
+void echeck_no_alloc_begin_m(struct eembed_log *err, const char *func,
+			     const char *file, int line);
+
+#define echeck_no_alloc_begin_l(log)\
+	echeck_no_alloc_begin_m(log, ECHECK_FUNC, __FILE__, __LINE__)
+
+#define echeck_no_alloc_begin()\
+	echeck_no_alloc_begin_m(NULL, ECHECK_FUNC, __FILE__, __LINE__)
+
+/* restores the previous allocator, returns the number of allocations */
+unsigned long echeck_no_alloc_end(void);
+
 #define echeck_test_main_log_failures(failures, funcname, filename) \
 	do { \
 		if (failures) { \
@@ -407,6 +574,7 @@ int main(void) \
 	eembed_system_print_init(); \
 	failures += pfunc(); \
 	echeck_test_main_log_failures(failures, #pfunc, __FILE__); \
+	eembed_flush_hooks_run(); \
 	return check_status(failures); \
 }
 #endif
@@ -421,6 +589,7 @@ int main(int argc, char **argv) \
 	verbose = (argc > 1) ? eembed_str_to_long(argv[1], NULL) : 0; \
 	failures = pfunc(verbose); \
 	echeck_test_main_log_failures(failures, #pfunc, __FILE__); \
+	eembed_flush_hooks_run(); \
 	return check_status(failures); \
 }
 #endif /* ECHECK_TEST_MAIN_V */
@@ -32,6 +32,12 @@ void serial_log_print_s(struct eembed_log *log, const char *s)
 	Serial.print(s);
 }
 
+void serial_log_print_n(struct eembed_log *log, const char *bytes, size_t len)
+{
+	(void)log;
+	Serial.write((const uint8_t *)bytes, len);
+}
+
 void serial_log_print_ul(struct eembed_log *log, uint64_t ul)
 {
 	(void)log;
@@ -62,11 +68,51 @@ void serial_log_print_eol(struct eembed_log *log)
 	Serial.println();
 }
 
+static size_t serial_write(void *context, const char *bytes, size_t len)
+{
+	(void)context;
+	return Serial.write((const uint8_t *)bytes, len);
+}
+
+static size_t serial_available_for_write(void *context)
+{
+	int avail = 0;
+	(void)context;
+	avail = Serial.availableForWrite();
+	return (avail > 0) ? (size_t)avail : 0;
+}
+
+struct eembed_serial eembed_arduino_serial = {
+	NULL,
+	serial_write,
+	serial_available_for_write
+};
+
+struct eembed_serial_log eembed_arduino_serial_log;
+struct eembed_log serial_buffered_log;
+static char serial_line[Eembed_arduino_serial_line_size];
+
+void eembed_arduino_serial_buffered_log_init(unsigned char non_blocking)
+{
+	eembed_serial_log_init(&serial_buffered_log,
+			       &eembed_arduino_serial_log, serial_line,
+			       sizeof(serial_line), &eembed_arduino_serial,
+			       non_blocking);
+	eembed_err_log = &serial_buffered_log;
+	eembed_out_log = &serial_buffered_log;
+
+	/* the partial line is written by the flush hooks before the crash */
+	eembed_flush_hook_add(&eembed_arduino_serial_log.out.flush_hook);
+	eembed_assert_crash = die;
+}
+
 void eembed_arduino_serial_log_init(void)
 {
 	serial_log.context = NULL;
 	serial_log.append_c = serial_log_print_c;
 	serial_log.append_s = serial_log_print_s;
+	serial_log.append_n = serial_log_print_n;
+	serial_log.append_fill = eembed_log_str_append_fill;
 	serial_log.append_ul = serial_log_print_ul;
 	serial_log.append_l = serial_log_print_l;
 	serial_log.append_f = serial_log_print_f;
@@ -211,4 +211,21 @@ extern unsigned long eembed_die_delay;
 
 void eembed_arduino_serial_log_init(void);
 
+/* Like eembed_arduino_serial_log_init, but each line is collected and then
+ * written with a single Serial.write; if "non_blocking" then a line which
+ * does not fit in the transmit buffer is dropped, and counted in
+ * eembed_arduino_serial_log.dropped. The line size defaults to the room of
+ * an empty transmit buffer (one less than its size), so that even with
+ * "non_blocking" a line is only dropped if the port is busy; a longer line
+ * is written in pieces, and if a piece is dropped so is the rest of it. */
+#ifndef Eembed_arduino_serial_line_size
+#ifdef SERIAL_TX_BUFFER_SIZE
+#define Eembed_arduino_serial_line_size (SERIAL_TX_BUFFER_SIZE - 1)
+#else
+#define Eembed_arduino_serial_line_size 63
+#endif
+#endif
+extern struct eembed_serial_log eembed_arduino_serial_log;
+void eembed_arduino_serial_buffered_log_init(unsigned char non_blocking);
+
 #endif /* EEMBED_ARDUINO_H */
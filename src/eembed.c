@@ -21,6 +21,34 @@
 #include <time.h>
 #endif
 
+#if Eembed_use_fd_log
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if Eembed_use_mmap_log
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if Eembed_use_diy_simd
+#include <immintrin.h>
+#endif
+
+#if __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#endif
+static char *eembed_ignore_const_s(const char *str)
+{
+	return (char *)(str);
+}
+
+#if __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
 #if EEMBED_HOSTED
 void (*eembed_exit)(int status) = exit;
 void eembed_exit_failure(void)
@@ -46,6 +74,21 @@ void eembed_no_op_append_s(struct eembed_log *log, const char *str)
 	(void)str;
 }
 
+void eembed_no_op_append_n(struct eembed_log *log, const char *bytes,
+			   size_t len)
+{
+	(void)log;
+	(void)bytes;
+	(void)len;
+}
+
+void eembed_no_op_append_fill(struct eembed_log *log, char c, size_t count)
+{
+	(void)log;
+	(void)c;
+	(void)count;
+}
+
 void eembed_no_op_append_ul(struct eembed_log *log, uint64_t ul)
 {
 	(void)log;
@@ -92,15 +135,36 @@ struct eembed_log eembed_no_op_log = {
 	eembed_no_op_append_fd,
 	eembed_no_op_append_vp,
 	eembed_no_op_append_eol,
+	eembed_no_op_append_n,
+	eembed_no_op_append_fill,
 };
 
 struct eembed_log *eembed_null_log = &eembed_no_op_log;
 
-void eembed_log_strbuf_append_s(struct eembed_log *log, const char *str)
+unsigned char eembed_log_level = eembed_log_level_info;
+EEMBED_THREAD_LOCAL unsigned char eembed_log_message_level = 0;
+
+/* The used length is trusted only while it still marks the end of the
+ * string; if the buffer was written to directly (e.g.: cleared with
+ * buf[0] = '\0' or with eembed_memset), then the length is measured again. */
+static size_t eembed_str_buf_used(struct eembed_str_buf *ctx)
+{
+	size_t used = ctx->used;
+
+	if ((used >= ctx->size) || (ctx->buf[used] != '\0')
+	    || (used && ((ctx->buf[0] == '\0')
+			 || (ctx->buf[used - 1] == '\0')))) {
+		used = eembed_strnlen(ctx->buf, ctx->size);
+		ctx->used = used;
+	}
+	return used;
+}
+
+/* copies "bytes" if not NULL, otherwise fills with "c" */
+static void eembed_log_strbuf_append(struct eembed_log *log, const char *bytes,
+				     char c, size_t len)
 {
 	size_t used = 0;
-	char *buf = NULL;
-	size_t size = 0;
 	size_t max = 0;
 	struct eembed_str_buf *ctx = NULL;
 
@@ -111,15 +175,72 @@ void eembed_log_strbuf_append_s(struct eembed_log *log, const char *str)
 	}
 
 	max = ctx->size - 1;
-	used = eembed_strnlen(ctx->buf, ctx->size);
+	used = eembed_str_buf_used(ctx);
 	if (used < max) {
-		buf = ctx->buf + used;
-		size = ctx->size - used;
-		eembed_strcpy_safe(buf, size, str);
+		len = (len < (max - used)) ? len : (max - used);
+		if (bytes) {
+			eembed_memcpy(ctx->buf + used, bytes, len);
+		} else {
+			eembed_memset(ctx->buf + used, c, len);
+		}
+		used += len;
+		ctx->buf[used] = '\0';
+		ctx->used = used;
 	}
 	eembed_assert(ctx->buf[max] == '\0');
 }
 
+void eembed_log_strbuf_append_s(struct eembed_log *log, const char *str)
+{
+	size_t used = 0;
+	size_t len = 0;
+	struct eembed_str_buf *ctx = NULL;
+
+	ctx = log ? (struct eembed_str_buf *)log->context : NULL;
+
+	if (!ctx || !ctx->buf || !ctx->size || !str) {
+		return;
+	}
+
+	/* the string need not be measured past the space available */
+	used = eembed_str_buf_used(ctx);
+	if (used < (ctx->size - 1)) {
+		len = eembed_strnlen(str, (ctx->size - 1) - used);
+		eembed_log_strbuf_append(log, str, '\0', len);
+	}
+}
+
+void eembed_log_strbuf_append_n(struct eembed_log *log, const char *bytes,
+				size_t len)
+{
+	if (bytes) {
+		eembed_log_strbuf_append(log, bytes, '\0', len);
+	}
+}
+
+void eembed_log_strbuf_append_fill(struct eembed_log *log, char c,
+				   size_t count)
+{
+	eembed_log_strbuf_append(log, NULL, c, count);
+}
+
+size_t eembed_str_buf_len(struct eembed_str_buf *ctx)
+{
+	if (!ctx || !ctx->buf || !ctx->size) {
+		return 0;
+	}
+	return eembed_str_buf_used(ctx);
+}
+
+void eembed_str_buf_reset(struct eembed_str_buf *ctx)
+{
+	if (!ctx || !ctx->buf || !ctx->size) {
+		return;
+	}
+	ctx->buf[0] = '\0';
+	ctx->used = 0;
+}
+
 void eembed_log_str_append_c(struct eembed_log *log, char c)
 {
 	char str[2] = { '\0', '\0' };
@@ -127,6 +248,55 @@ void eembed_log_str_append_c(struct eembed_log *log, char c)
 	log->append_s(log, str);
 }
 
+void eembed_log_append_n(struct eembed_log *log, const char *bytes,
+			 size_t len)
+{
+	if (log->append_n) {
+		log->append_n(log, bytes, len);
+	} else {
+		eembed_log_str_append_n(log, bytes, len);
+	}
+}
+
+void eembed_log_append_fill(struct eembed_log *log, char c, size_t count)
+{
+	if (log->append_fill) {
+		log->append_fill(log, c, count);
+	} else {
+		eembed_log_str_append_fill(log, c, count);
+	}
+}
+
+void eembed_log_str_append_n(struct eembed_log *log, const char *bytes,
+			     size_t len)
+{
+	char str[64];
+	size_t n = 0;
+
+	while (bytes && len) {
+		n = (len < (sizeof(str) - 1)) ? len : (sizeof(str) - 1);
+		eembed_memcpy(str, bytes, n);
+		str[n] = '\0';
+		log->append_s(log, str);
+		bytes += n;
+		len -= n;
+	}
+}
+
+void eembed_log_str_append_fill(struct eembed_log *log, char c, size_t count)
+{
+	char str[64];
+	size_t n = 0;
+
+	n = (count < sizeof(str)) ? count : sizeof(str);
+	eembed_memset(str, c, n);
+	while (count) {
+		n = (count < sizeof(str)) ? count : sizeof(str);
+		eembed_log_append_n(log, str, n);
+		count -= n;
+	}
+}
+
 void eembed_log_str_append_ul(struct eembed_log *log, uint64_t ul)
 {
 	char str[25] = { '\0' };
@@ -163,43 +333,1459 @@ void eembed_log_str_append_vp(struct eembed_log *log, const void *ptr)
 	log->append_s(log, str);
 }
 
-void eembed_log_str_append_eol(struct eembed_log *log)
+void eembed_log_str_append_eol(struct eembed_log *log)
+{
+	log->append_s(log, "\n");
+}
+
+struct eembed_log *eembed_char_buf_log_init(struct eembed_log *log,
+					    struct eembed_str_buf *ctx,
+					    char *buf, size_t size)
+{
+	if (!log) {
+		return NULL;
+	}
+
+	log->context = ctx;
+	log->append_c = eembed_log_str_append_c;
+	log->append_s = eembed_log_strbuf_append_s;
+	log->append_n = eembed_log_strbuf_append_n;
+	log->append_fill = eembed_log_strbuf_append_fill;
+	log->append_ul = eembed_log_str_append_ul;
+	log->append_l = eembed_log_str_append_l;
+	log->append_f = eembed_log_str_append_f;
+	log->append_fd = eembed_log_str_append_fd;
+	log->append_vp = eembed_log_str_append_vp;
+	log->append_eol = eembed_log_str_append_eol;
+
+	if (!log->context) {
+		return NULL;
+	}
+
+	ctx->buf = buf;
+	ctx->used = 0;
+	if (!ctx->buf) {
+		ctx->size = 0;
+		return NULL;
+	}
+
+	ctx->size = size;
+	if (!ctx->size) {
+		return NULL;
+	}
+
+	/* appends continue after any string already in the buffer */
+	ctx->buf[ctx->size - 1] = '\0';
+	ctx->used = eembed_strnlen(ctx->buf, ctx->size);
+
+	return log;
+}
+
+static struct eembed_flush_hook *eembed_flush_hooks = NULL;
+static unsigned char eembed_flush_hooks_running = 0;
+
+void eembed_flush_hooks_run(void)
+{
+	struct eembed_flush_hook *hook = NULL;
+	struct eembed_flush_hook *next = NULL;
+
+	/* a hook which crashes must not cause the hooks to run again */
+	if (eembed_flush_hooks_running) {
+		return;
+	}
+	eembed_flush_hooks_running = 1;
+	/* a hook may remove itself */
+	for (hook = eembed_flush_hooks; hook; hook = next) {
+		next = hook->next;
+		hook->flush(hook->context);
+	}
+	eembed_flush_hooks_running = 0;
+}
+
+void eembed_flush_hook_add(struct eembed_flush_hook *hook)
+{
+#if EEMBED_HOSTED
+	static unsigned char registered_atexit = 0;
+	if (!registered_atexit) {
+		registered_atexit = (atexit(eembed_flush_hooks_run) == 0);
+	}
+#endif
+	eembed_assert(hook && hook->flush);
+	eembed_flush_hook_remove(hook);
+	hook->next = eembed_flush_hooks;
+	eembed_flush_hooks = hook;
+}
+
+void eembed_flush_hook_remove(struct eembed_flush_hook *hook)
+{
+	struct eembed_flush_hook **pos = &eembed_flush_hooks;
+
+	while (*pos && *pos != hook) {
+		pos = &((*pos)->next);
+	}
+	if (*pos) {
+		*pos = hook->next;
+		hook->next = NULL;
+	}
+}
+
+void eembed_buffered_log_flush(struct eembed_buffered_log *ctx)
+{
+	if (ctx->used) {
+		ctx->write(ctx->sink, ctx->buf, ctx->used);
+		ctx->used = 0;
+	}
+}
+
+static void eembed_buffered_log_flush_hook(void *context)
+{
+	eembed_buffered_log_flush((struct eembed_buffered_log *)context);
+}
+
+static void eembed_buffered_log_append_bytes(struct eembed_buffered_log *ctx,
+					     const char *bytes, size_t len)
+{
+	size_t n = 0;
+
+	while (len) {
+		if (ctx->used == ctx->size) {
+			eembed_buffered_log_flush(ctx);
+		}
+		/* too big to be buffered, thus pass it along as-is */
+		if (!ctx->used && len >= ctx->size) {
+			ctx->write(ctx->sink, bytes, len);
+			return;
+		}
+		n = ctx->size - ctx->used;
+		n = (n < len) ? n : len;
+		eembed_memcpy(ctx->buf + ctx->used, bytes, n);
+		ctx->used += n;
+		bytes += n;
+		len -= n;
+	}
+}
+
+void eembed_buffered_log_append_s(struct eembed_log *log, const char *str)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	if (str) {
+		eembed_buffered_log_append_bytes(ctx, str, eembed_strlen(str));
+	}
+}
+
+void eembed_buffered_log_append_n(struct eembed_log *log, const char *bytes,
+				  size_t len)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	if (bytes) {
+		eembed_buffered_log_append_bytes(ctx, bytes, len);
+	}
+}
+
+void eembed_buffered_log_append_c(struct eembed_log *log, char c)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	eembed_buffered_log_append_bytes(ctx, &c, 1);
+}
+
+void eembed_buffered_log_append_eol(struct eembed_log *log)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	eembed_buffered_log_append_bytes(ctx, "\n", 1);
+	if (ctx->flush_on_eol) {
+		eembed_buffered_log_flush(ctx);
+	}
+}
+
+struct eembed_log *eembed_buffered_log_init(struct eembed_log *log,
+					    struct eembed_buffered_log *ctx,
+					    char *buf, size_t size,
+					    void (*write)(void *sink,
+							  const char *bytes,
+							  size_t len),
+					    void *sink)
+{
+	if (!log || !ctx || !write) {
+		return NULL;
+	}
+
+	ctx->buf = buf;
+	ctx->size = buf ? size : 0;
+	ctx->used = 0;
+	ctx->write = write;
+	ctx->sink = sink;
+	ctx->flush_on_eol = 0;
+	ctx->flush_hook.flush = eembed_buffered_log_flush_hook;
+	ctx->flush_hook.context = ctx;
+	ctx->flush_hook.next = NULL;
+
+	log->context = ctx;
+	log->append_c = eembed_buffered_log_append_c;
+	log->append_s = eembed_buffered_log_append_s;
+	log->append_n = eembed_buffered_log_append_n;
+	log->append_fill = eembed_log_str_append_fill;
+	log->append_ul = eembed_log_str_append_ul;
+	log->append_l = eembed_log_str_append_l;
+	log->append_f = eembed_log_str_append_f;
+	log->append_fd = eembed_log_str_append_fd;
+	log->append_vp = eembed_log_str_append_vp;
+	log->append_eol = eembed_buffered_log_append_eol;
+
+	return log;
+}
+
+static void eembed_binary_log_varint(struct eembed_log *log, char tag,
+				     uint64_t val)
+{
+	struct eembed_binary_log *ctx = NULL;
+	char bytes[12];
+	size_t len = 0;
+
+	ctx = (struct eembed_binary_log *)log->context;
+	bytes[len++] = tag;
+	do {
+		bytes[len] = (char)(val & 0x7F);
+		val = val >> 7;
+		if (val) {
+			bytes[len] = (char)(bytes[len] | 0x80);
+		}
+		++len;
+	} while (val);
+	eembed_buffered_log_append_bytes(&ctx->out, bytes, len);
+}
+
+void eembed_binary_log_append_n(struct eembed_log *log, const char *bytes,
+				size_t len)
+{
+	struct eembed_binary_log *ctx = NULL;
+
+	ctx = (struct eembed_binary_log *)log->context;
+	if (!bytes) {
+		return;
+	}
+	eembed_binary_log_varint(log, eembed_binary_log_tag_s, len);
+	eembed_buffered_log_append_bytes(&ctx->out, bytes, len);
+}
+
+void eembed_binary_log_append_s(struct eembed_log *log, const char *str)
+{
+	struct eembed_binary_log *ctx = NULL;
+	size_t i = 0;
+
+	ctx = (struct eembed_binary_log *)log->context;
+	if (!str) {
+		return;
+	}
+	for (i = 0; i < ctx->strings_len; ++i) {
+		if (ctx->strings[i] == str) {
+			eembed_binary_log_varint(log, eembed_binary_log_tag_id,
+						 i);
+			return;
+		}
+	}
+	eembed_binary_log_append_n(log, str, eembed_strlen(str));
+}
+
+void eembed_binary_log_append_c(struct eembed_log *log, char c)
+{
+	struct eembed_binary_log *ctx = NULL;
+	char bytes[2];
+
+	ctx = (struct eembed_binary_log *)log->context;
+	bytes[0] = eembed_binary_log_tag_c;
+	bytes[1] = c;
+	eembed_buffered_log_append_bytes(&ctx->out, bytes, 2);
+}
+
+void eembed_binary_log_append_ul(struct eembed_log *log, uint64_t ul)
+{
+	eembed_binary_log_varint(log, eembed_binary_log_tag_ul, ul);
+}
+
+void eembed_binary_log_append_l(struct eembed_log *log, int64_t l)
+{
+	uint64_t zigzag = 0;
+
+	zigzag = (l < 0) ? (((~((uint64_t)l)) << 1) | 1) : (((uint64_t)l) << 1);
+	eembed_binary_log_varint(log, eembed_binary_log_tag_l, zigzag);
+}
+
+void eembed_binary_log_append_fd(struct eembed_log *log, long double f,
+				 uint8_t d)
+{
+	struct eembed_binary_log *ctx = NULL;
+	char bytes[3 + sizeof(double)];
+	double dbl = (double)f;
+	size_t len = 0;
+
+	ctx = (struct eembed_binary_log *)log->context;
+	/* a "d" of zero records eembed_binary_log_tag_f */
+	if (d) {
+		bytes[len++] = eembed_binary_log_tag_fd;
+		bytes[len++] = (char)d;
+	} else {
+		bytes[len++] = eembed_binary_log_tag_f;
+	}
+	bytes[len++] = (char)sizeof(double);
+	eembed_memcpy(bytes + len, &dbl, sizeof(double));
+	len += sizeof(double);
+	eembed_buffered_log_append_bytes(&ctx->out, bytes, len);
+}
+
+void eembed_binary_log_append_f(struct eembed_log *log, long double f)
+{
+	eembed_binary_log_append_fd(log, f, 0);
+}
+
+void eembed_binary_log_append_vp(struct eembed_log *log, const void *ptr)
+{
+	eembed_binary_log_varint(log, eembed_binary_log_tag_vp, (size_t)ptr);
+}
+
+void eembed_binary_log_append_eol(struct eembed_log *log)
+{
+	struct eembed_binary_log *ctx = NULL;
+	char tag = eembed_binary_log_tag_eol;
+
+	ctx = (struct eembed_binary_log *)log->context;
+	eembed_buffered_log_append_bytes(&ctx->out, &tag, 1);
+	if (ctx->out.flush_on_eol) {
+		eembed_buffered_log_flush(&ctx->out);
+	}
+}
+
+struct eembed_log *eembed_binary_log_init(struct eembed_log *log,
+					  struct eembed_binary_log *ctx,
+					  char *buf, size_t size,
+					  void (*write)(void *sink,
+							const char *bytes,
+							size_t len),
+					  void *sink, const char **strings,
+					  size_t strings_len)
+{
+	if (!ctx || !eembed_buffered_log_init(log, &ctx->out, buf, size,
+					      write, sink)) {
+		return NULL;
+	}
+	ctx->strings = strings;
+	ctx->strings_len = strings ? strings_len : 0;
+
+	log->context = ctx;
+	log->append_c = eembed_binary_log_append_c;
+	log->append_s = eembed_binary_log_append_s;
+	log->append_n = eembed_binary_log_append_n;
+	log->append_fill = eembed_log_str_append_fill;
+	log->append_ul = eembed_binary_log_append_ul;
+	log->append_l = eembed_binary_log_append_l;
+	log->append_f = eembed_binary_log_append_f;
+	log->append_fd = eembed_binary_log_append_fd;
+	log->append_vp = eembed_binary_log_append_vp;
+	log->append_eol = eembed_binary_log_append_eol;
+
+	return log;
+}
+
+/* returns the number of bytes of the varint, or 0 if incomplete */
+static size_t eembed_binary_log_read_varint(const unsigned char *bytes,
+					    size_t len, uint64_t *val)
+{
+	size_t i = 0;
+
+	*val = 0;
+	for (i = 0; i < len && i < 10; ++i) {
+		*val |= ((uint64_t)(bytes[i] & 0x7F)) << (7 * i);
+		if (!(bytes[i] & 0x80)) {
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+static void eembed_binary_log_decode_s(struct eembed_log *log,
+				       const unsigned char *bytes, size_t len)
+{
+	char str[32];
+	size_t n = 0;
+
+	while (len) {
+		n = (len < (sizeof(str) - 1)) ? len : (sizeof(str) - 1);
+		eembed_memcpy(str, bytes, n);
+		str[n] = '\0';
+		log->append_s(log, str);
+		bytes += n;
+		len -= n;
+	}
+}
+
+/* returns the size of the record, or 0 if incomplete or unknown */
+static size_t eembed_binary_log_decode_record(struct eembed_log *log,
+					      const unsigned char *bytes,
+					      size_t len, const char **strings,
+					      size_t strings_len)
+{
+	size_t pos = 1;
+	size_t n = 0;
+	uint64_t val = 0;
+	uint8_t digits = 0;
+	double dbl = 0.0;
+	float flt = 0.0;
+
+	switch (bytes[0]) {
+	case eembed_binary_log_tag_c:
+		if (len < 2) {
+			return 0;
+		}
+		log->append_c(log, (char)bytes[1]);
+		return 2;
+	case eembed_binary_log_tag_eol:
+		log->append_eol(log);
+		return 1;
+	case eembed_binary_log_tag_fd:
+	case eembed_binary_log_tag_f:
+		if (bytes[0] == eembed_binary_log_tag_fd) {
+			digits = (len > pos) ? bytes[pos++] : 0;
+		}
+		n = (len > pos) ? bytes[pos++] : 0;
+		if (!(n == sizeof(double) || n == sizeof(float))
+		    || (len - pos) < n) {
+			return 0;
+		}
+		if (n == sizeof(double)) {
+			eembed_memcpy(&dbl, bytes + pos, n);
+		} else {
+			eembed_memcpy(&flt, bytes + pos, n);
+			dbl = flt;
+		}
+		if (digits) {
+			log->append_fd(log, dbl, digits);
+		} else {
+			log->append_f(log, dbl);
+		}
+		return pos + n;
+	default:
+		break;
+	}
+
+	n = eembed_binary_log_read_varint(bytes + pos, len - pos, &val);
+	if (!n) {
+		return 0;
+	}
+	pos += n;
+
+	switch (bytes[0]) {
+	case eembed_binary_log_tag_s:
+		if ((len - pos) < val) {
+			return 0;
+		}
+		eembed_binary_log_decode_s(log, bytes + pos, (size_t)val);
+		return pos + (size_t)val;
+	case eembed_binary_log_tag_id:
+		log->append_s(log, (val < strings_len) ? strings[val] : "?");
+		return pos;
+	case eembed_binary_log_tag_ul:
+		log->append_ul(log, val);
+		return pos;
+	case eembed_binary_log_tag_l:
+		log->append_l(log, (val & 1) ? (-((int64_t)(val >> 1)) - 1)
+			      : (int64_t)(val >> 1));
+		return pos;
+	case eembed_binary_log_tag_vp:
+		log->append_vp(log, (const void *)(size_t)val);
+		return pos;
+	default:
+		return 0;
+	}
+}
+
+size_t eembed_binary_log_decode(struct eembed_log *log,
+				const unsigned char *bytes, size_t len,
+				const char **strings, size_t strings_len)
+{
+	size_t pos = 0;
+	size_t n = 0;
+
+	if (!strings) {
+		strings_len = 0;
+	}
+	while (pos < len) {
+		n = eembed_binary_log_decode_record(log, bytes + pos,
+						    len - pos, strings,
+						    strings_len);
+		if (!n) {
+			break;
+		}
+		pos += n;
+	}
+	return pos;
+}
+
+#define eembed_circular_log_magic 0xEEC1C10CUL
+
+static struct eembed_circular_log_header *
+eembed_circular_log_valid(const unsigned char *bytes, size_t len)
+{
+	struct eembed_circular_log_header *header = NULL;
+	size_t hlen = sizeof(struct eembed_circular_log_header);
+
+	if (!bytes || len <= hlen) {
+		return NULL;
+	}
+	header = (struct eembed_circular_log_header *)
+	    eembed_ignore_const_s((const char *)bytes);
+	if (header->magic != eembed_circular_log_magic
+	    || header->size != (uint32_t)(len - hlen)
+	    || header->next >= header->size) {
+		return NULL;
+	}
+	return header;
+}
+
+void eembed_circular_log_clear(unsigned char *bytes, size_t len)
+{
+	struct eembed_circular_log_header *header = NULL;
+	size_t hlen = sizeof(struct eembed_circular_log_header);
+
+	if (!bytes || len <= hlen) {
+		return;
+	}
+	header = (struct eembed_circular_log_header *)bytes;
+	header->magic = eembed_circular_log_magic;
+	header->size = (uint32_t)(len - hlen);
+	header->next = 0;
+	header->wrapped = 0;
+}
+
+static void eembed_circular_log_append_n(struct eembed_log *log,
+					 const char *str, size_t len)
+{
+	struct eembed_circular_log_header *header = NULL;
+	unsigned char *data = NULL;
+	size_t n = 0;
+
+	header = (struct eembed_circular_log_header *)log->context;
+	data = ((unsigned char *)header) + sizeof(*header);
+	len = str ? len : 0;
+	/* only the tail of a string larger than the buffer is retained */
+	if (len > header->size) {
+		str += (len - header->size);
+		len = header->size;
+	}
+	while (len) {
+		n = header->size - header->next;
+		n = (n < len) ? n : len;
+		eembed_memcpy(data + header->next, str, n);
+		str += n;
+		len -= n;
+		header->next += n;
+		if (header->next == header->size) {
+			header->next = 0;
+			header->wrapped = 1;
+		}
+	}
+}
+
+static void eembed_circular_log_append_s(struct eembed_log *log,
+					 const char *str)
+{
+	eembed_circular_log_append_n(log, str, str ? eembed_strlen(str) : 0);
+}
+
+struct eembed_log *eembed_circular_log_init(struct eembed_log *log,
+					    unsigned char *bytes, size_t len)
+{
+	size_t hlen = sizeof(struct eembed_circular_log_header);
+
+	if (!log || !bytes || len <= hlen) {
+		return NULL;
+	}
+	if (!eembed_circular_log_valid(bytes, len)) {
+		eembed_circular_log_clear(bytes, len);
+	}
+
+	log->context = bytes;
+	log->append_c = eembed_log_str_append_c;
+	log->append_s = eembed_circular_log_append_s;
+	log->append_n = eembed_circular_log_append_n;
+	log->append_fill = eembed_log_str_append_fill;
+	log->append_ul = eembed_log_str_append_ul;
+	log->append_l = eembed_log_str_append_l;
+	log->append_f = eembed_log_str_append_f;
+	log->append_fd = eembed_log_str_append_fd;
+	log->append_vp = eembed_log_str_append_vp;
+	log->append_eol = eembed_log_str_append_eol;
+
+	return log;
+}
+
+static size_t eembed_circular_log_dump_range(struct eembed_log *out,
+					     const unsigned char *data,
+					     size_t from, size_t to)
+{
+	char str[32];
+	size_t n = 0;
+	size_t i = from;
+
+	while (i < to) {
+		n = ((to - i) < (sizeof(str) - 1)) ? (to - i) : sizeof(str) - 1;
+		eembed_memcpy(str, data + i, n);
+		str[n] = '\0';
+		out->append_s(out, str);
+		i += n;
+	}
+	return to - from;
+}
+
+size_t eembed_circular_log_dump(struct eembed_log *out,
+				const unsigned char *bytes, size_t len)
+{
+	struct eembed_circular_log_header *header = NULL;
+	const unsigned char *data = NULL;
+	size_t dumped = 0;
+
+	header = eembed_circular_log_valid(bytes, len);
+	if (!out || !header) {
+		return 0;
+	}
+	data = bytes + sizeof(struct eembed_circular_log_header);
+	if (header->wrapped) {
+		dumped += eembed_circular_log_dump_range(out, data,
+							 header->next,
+							 header->size);
+	}
+	dumped += eembed_circular_log_dump_range(out, data, 0, header->next);
+	return dumped;
+}
+
+static void eembed_tee_log_append_n(struct eembed_log *log,
+				    const char *bytes, size_t len)
+{
+	struct eembed_tee_log *ctx = (struct eembed_tee_log *)log->context;
+	struct eembed_tee_log_sink *sink = NULL;
+	size_t i = 0;
+
+	for (i = 0; i < ctx->sinks_len; ++i) {
+		sink = ctx->sinks + i;
+		if (eembed_log_message_level <= sink->level) {
+			eembed_log_append_n(sink->log, bytes, len);
+		}
+	}
+}
+
+static void eembed_tee_log_append_s(struct eembed_log *log, const char *str)
+{
+	if (str) {
+		eembed_tee_log_append_n(log, str, eembed_strlen(str));
+	}
+}
+
+static void eembed_tee_log_append_c(struct eembed_log *log, char c)
+{
+	eembed_tee_log_append_n(log, &c, 1);
+}
+
+static void eembed_tee_log_append_fill(struct eembed_log *log, char c,
+				       size_t count)
+{
+	struct eembed_tee_log *ctx = (struct eembed_tee_log *)log->context;
+	struct eembed_tee_log_sink *sink = NULL;
+	size_t i = 0;
+
+	for (i = 0; i < ctx->sinks_len; ++i) {
+		sink = ctx->sinks + i;
+		if (eembed_log_message_level <= sink->level) {
+			eembed_log_append_fill(sink->log, c, count);
+		}
+	}
+}
+
+static void eembed_tee_log_append_eol(struct eembed_log *log)
+{
+	struct eembed_tee_log *ctx = (struct eembed_tee_log *)log->context;
+	struct eembed_tee_log_sink *sink = NULL;
+	size_t i = 0;
+
+	for (i = 0; i < ctx->sinks_len; ++i) {
+		sink = ctx->sinks + i;
+		if (eembed_log_message_level <= sink->level) {
+			sink->log->append_eol(sink->log);
+		}
+	}
+}
+
+struct eembed_log *eembed_tee_log_init(struct eembed_log *log,
+				       struct eembed_tee_log *ctx,
+				       struct eembed_tee_log_sink *sinks,
+				       size_t sinks_len)
+{
+	if (!log || !ctx) {
+		return NULL;
+	}
+	ctx->sinks = sinks;
+	ctx->sinks_len = sinks ? sinks_len : 0;
+
+	/* the numbers are formatted once, then passed to the append_s */
+	log->context = ctx;
+	log->append_c = eembed_tee_log_append_c;
+	log->append_s = eembed_tee_log_append_s;
+	log->append_n = eembed_tee_log_append_n;
+	log->append_fill = eembed_tee_log_append_fill;
+	log->append_ul = eembed_log_str_append_ul;
+	log->append_l = eembed_log_str_append_l;
+	log->append_f = eembed_log_str_append_f;
+	log->append_fd = eembed_log_str_append_fd;
+	log->append_vp = eembed_log_str_append_vp;
+	log->append_eol = eembed_tee_log_append_eol;
+
+	return log;
+}
+
+#define eembed_fnv32_offset 2166136261UL
+#define eembed_fnv32_prime 16777619UL
+
+/* the bytes are hashed only if "hash" is set, the numbers are not */
+static void eembed_dedup_log_add(struct eembed_dedup_log *ctx,
+				 const char *bytes, size_t len, int hash)
+{
+	size_t i = 0;
+	size_t n = 0;
+
+	if (hash) {
+		for (i = 0; i < len; ++i) {
+			ctx->hash ^= (unsigned char)bytes[i];
+			ctx->hash *= eembed_fnv32_prime;
+		}
+	}
+	/* a long line is truncated, but all of it is hashed */
+	n = (ctx->line_size - 1) - ctx->used;
+	n = (n < len) ? n : len;
+	eembed_memcpy(ctx->line + ctx->used, bytes, n);
+	ctx->used += n;
+}
+
+static void eembed_dedup_log_append_n(struct eembed_log *log,
+				      const char *bytes, size_t len)
+{
+	if (bytes) {
+		eembed_dedup_log_add((struct eembed_dedup_log *)log->context,
+				     bytes, len, 1);
+	}
+}
+
+static void eembed_dedup_log_append_s(struct eembed_log *log, const char *str)
+{
+	eembed_dedup_log_append_n(log, str, str ? eembed_strlen(str) : 0);
+}
+
+static void eembed_dedup_log_append_c(struct eembed_log *log, char c)
+{
+	eembed_dedup_log_append_n(log, &c, 1);
+}
+
+static void eembed_dedup_log_append_ul(struct eembed_log *log, uint64_t ul)
+{
+	char str[25] = { '\0' };
+	eembed_ulong_to_str(str, sizeof(str), ul);
+	eembed_dedup_log_add((struct eembed_dedup_log *)log->context, str,
+			     eembed_strlen(str), 0);
+}
+
+static void eembed_dedup_log_append_l(struct eembed_log *log, int64_t l)
+{
+	char str[25] = { '\0' };
+	eembed_long_to_str(str, sizeof(str), l);
+	eembed_dedup_log_add((struct eembed_dedup_log *)log->context, str,
+			     eembed_strlen(str), 0);
+}
+
+static void eembed_dedup_log_append_f(struct eembed_log *log, long double f)
+{
+	char str[25] = { '\0' };
+	eembed_float_to_str(str, sizeof(str), f);
+	eembed_dedup_log_add((struct eembed_dedup_log *)log->context, str,
+			     eembed_strlen(str), 0);
+}
+
+static void eembed_dedup_log_append_fd(struct eembed_log *log, long double f,
+				       uint8_t d)
+{
+	char str[25] = { '\0' };
+	eembed_float_fraction_to_str(str, sizeof(str), f, d);
+	eembed_dedup_log_add((struct eembed_dedup_log *)log->context, str,
+			     eembed_strlen(str), 0);
+}
+
+static void eembed_dedup_log_append_vp(struct eembed_log *log,
+				       const void *ptr)
+{
+	char str[25] = { '\0' };
+	eembed_ulong_to_hex(str, sizeof(str), (size_t)ptr);
+	eembed_dedup_log_add((struct eembed_dedup_log *)log->context, str,
+			     eembed_strlen(str), 0);
+}
+
+static void eembed_dedup_log_summary(struct eembed_dedup_log *ctx,
+				     struct eembed_dedup_log_entry *entry)
+{
+	struct eembed_log *sink = ctx->sink;
+
+	if (entry->suppressed) {
+		sink->append_s(sink, "suppressed ");
+		sink->append_ul(sink, entry->suppressed);
+		sink->append_s(sink, " similar lines");
+		sink->append_eol(sink);
+		entry->suppressed = 0;
+	}
+}
+
+static void eembed_dedup_log_reset_line(struct eembed_dedup_log *ctx)
+{
+	ctx->used = 0;
+	ctx->hash = eembed_fnv32_offset;
+}
+
+static void eembed_dedup_log_append_eol(struct eembed_log *log)
+{
+	struct eembed_dedup_log *ctx = (struct eembed_dedup_log *)log->context;
+	struct eembed_dedup_log_entry *entry = NULL;
+	struct eembed_log *sink = ctx->sink;
+	uint64_t now = 0;
+
+	now = ctx->now_ns ? ctx->now_ns() : 0;
+	entry = ctx->entries + (ctx->hash % ctx->entries_len);
+	if (entry->hash != ctx->hash || !entry->count
+	    || (now - entry->window_start) >= ctx->window_ns) {
+		/* another line is using the entry, or a new window */
+		eembed_dedup_log_summary(ctx, entry);
+		entry->hash = ctx->hash;
+		entry->count = 0;
+		entry->window_start = now;
+	}
+	++entry->count;
+
+	if (entry->count > ctx->limit) {
+		if ((entry->suppressed + 1) < ctx->summary_every) {
+			++entry->suppressed;
+			eembed_dedup_log_reset_line(ctx);
+			return;
+		}
+		/* the summary comes before the line which is passed along */
+		eembed_dedup_log_summary(ctx, entry);
+	}
+	eembed_log_append_n(sink, ctx->line, ctx->used);
+	sink->append_eol(sink);
+	eembed_dedup_log_reset_line(ctx);
+}
+
+void eembed_dedup_log_flush(struct eembed_dedup_log *ctx)
+{
+	struct eembed_log *sink = ctx->sink;
+	size_t i = 0;
+
+	for (i = 0; i < ctx->entries_len; ++i) {
+		eembed_dedup_log_summary(ctx, ctx->entries + i);
+	}
+	/* a line without its eol is passed on as it is, not counted */
+	if (ctx->used) {
+		eembed_log_append_n(sink, ctx->line, ctx->used);
+		sink->append_eol(sink);
+		eembed_dedup_log_reset_line(ctx);
+	}
+}
+
+static void eembed_dedup_log_flush_hook(void *context)
+{
+	eembed_dedup_log_flush((struct eembed_dedup_log *)context);
+}
+
+struct eembed_log *eembed_dedup_log_init(struct eembed_log *log,
+					 struct eembed_dedup_log *ctx,
+					 char *line, size_t line_size,
+					 struct eembed_dedup_log_entry
+					 *entries, size_t entries_len,
+					 uint64_t (*now_ns)(void),
+					 struct eembed_log *sink)
+{
+#if (EEMBED_HOSTED || FAUX_FREESTANDING)
+	if (!now_ns) {
+		now_ns = eembed_hosted_uptime_ns_coarse;
+	}
+#endif
+	if (!log || !ctx || !line || !line_size || !entries || !entries_len
+	    || !sink) {
+		return NULL;
+	}
+
+	eembed_memset(entries, 0x00,
+		      sizeof(struct eembed_dedup_log_entry) * entries_len);
+	ctx->sink = sink;
+	ctx->line = line;
+	ctx->line_size = line_size;
+	eembed_dedup_log_reset_line(ctx);
+	ctx->entries = entries;
+	ctx->entries_len = entries_len;
+	ctx->limit = 3;
+	ctx->summary_every = 100;
+	ctx->now_ns = now_ns;
+	ctx->window_ns = 1000UL * 1000UL * 1000UL;
+	ctx->flush_hook.flush = eembed_dedup_log_flush_hook;
+	ctx->flush_hook.context = ctx;
+	ctx->flush_hook.next = NULL;
+
+	log->context = ctx;
+	log->append_c = eembed_dedup_log_append_c;
+	log->append_s = eembed_dedup_log_append_s;
+	log->append_n = eembed_dedup_log_append_n;
+	log->append_fill = eembed_log_str_append_fill;
+	log->append_ul = eembed_dedup_log_append_ul;
+	log->append_l = eembed_dedup_log_append_l;
+	log->append_f = eembed_dedup_log_append_f;
+	log->append_fd = eembed_dedup_log_append_fd;
+	log->append_vp = eembed_dedup_log_append_vp;
+	log->append_eol = eembed_dedup_log_append_eol;
+
+	return log;
+}
+
+static void eembed_timestamp_log_stamp(struct eembed_timestamp_log *ctx)
+{
+	char str[32];
+	uint64_t ns = 0;
+	uint32_t frac = 0;
+	size_t len = 0;
+	size_t i = 0;
+
+	if (ctx->line_started) {
+		return;
+	}
+	ctx->line_started = 1;
+
+	ns = ctx->now_ns();
+	eembed_ulong_to_str(str, sizeof(str) - 11, ns / (1000 * 1000 * 1000));
+	len = eembed_strlen(str);
+	str[len++] = '.';
+	frac = (uint32_t)(ns % (1000 * 1000 * 1000));
+	for (i = 9; i; --i) {
+		str[len + i - 1] = (char)('0' + (frac % 10));
+		frac = frac / 10;
+	}
+	len += 9;
+	str[len++] = ' ';
+	eembed_log_append_n(ctx->sink, str, len);
+}
+
+static void eembed_timestamp_log_append_c(struct eembed_log *log, char c)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_c(ctx->sink, c);
+}
+
+static void eembed_timestamp_log_append_s(struct eembed_log *log,
+					  const char *str)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_s(ctx->sink, str);
+}
+
+static void eembed_timestamp_log_append_n(struct eembed_log *log,
+					  const char *bytes, size_t len)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	eembed_log_append_n(ctx->sink, bytes, len);
+}
+
+static void eembed_timestamp_log_append_fill(struct eembed_log *log, char c,
+					     size_t count)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	eembed_log_append_fill(ctx->sink, c, count);
+}
+
+static void eembed_timestamp_log_append_ul(struct eembed_log *log,
+					   uint64_t ul)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_ul(ctx->sink, ul);
+}
+
+static void eembed_timestamp_log_append_l(struct eembed_log *log, int64_t l)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_l(ctx->sink, l);
+}
+
+static void eembed_timestamp_log_append_f(struct eembed_log *log,
+					  long double f)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_f(ctx->sink, f);
+}
+
+static void eembed_timestamp_log_append_fd(struct eembed_log *log,
+					   long double f, uint8_t d)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_fd(ctx->sink, f, d);
+}
+
+static void eembed_timestamp_log_append_vp(struct eembed_log *log,
+					   const void *ptr)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_vp(ctx->sink, ptr);
+}
+
+static void eembed_timestamp_log_append_eol(struct eembed_log *log)
+{
+	struct eembed_timestamp_log *ctx = NULL;
+
+	ctx = (struct eembed_timestamp_log *)log->context;
+	eembed_timestamp_log_stamp(ctx);
+	ctx->sink->append_eol(ctx->sink);
+	ctx->line_started = 0;
+}
+
+struct eembed_log *eembed_timestamp_log_init(struct eembed_log *log,
+					     struct eembed_timestamp_log *ctx,
+					     uint64_t (*now_ns)(void),
+					     struct eembed_log *sink)
+{
+#if (EEMBED_HOSTED || FAUX_FREESTANDING)
+	if (!now_ns) {
+		now_ns = eembed_hosted_uptime_ns;
+	}
+#endif
+	if (!log || !ctx || !now_ns || !sink) {
+		return NULL;
+	}
+
+	ctx->sink = sink;
+	ctx->now_ns = now_ns;
+	ctx->line_started = 0;
+
+	log->context = ctx;
+	log->append_c = eembed_timestamp_log_append_c;
+	log->append_s = eembed_timestamp_log_append_s;
+	log->append_n = eembed_timestamp_log_append_n;
+	log->append_fill = eembed_timestamp_log_append_fill;
+	log->append_ul = eembed_timestamp_log_append_ul;
+	log->append_l = eembed_timestamp_log_append_l;
+	log->append_f = eembed_timestamp_log_append_f;
+	log->append_fd = eembed_timestamp_log_append_fd;
+	log->append_vp = eembed_timestamp_log_append_vp;
+	log->append_eol = eembed_timestamp_log_append_eol;
+
+	return log;
+}
+
+static void eembed_serial_log_write(void *sink, const char *bytes, size_t len)
+{
+	struct eembed_serial_log *ctx = (struct eembed_serial_log *)sink;
+	struct eembed_serial *serial = ctx->serial;
+
+	if (!ctx->dropping && ctx->non_blocking
+	    && serial->available_for_write(serial->context) < len) {
+		++ctx->dropped;
+		ctx->dropping = 1;
+	}
+	if (ctx->dropping) {
+		/* the rest of the line goes with the dropped piece */
+		ctx->dropping = (bytes[len - 1] != '\n');
+		return;
+	}
+	serial->write(serial->context, bytes, len);
+}
+
+struct eembed_log *eembed_serial_log_init(struct eembed_log *log,
+					  struct eembed_serial_log *ctx,
+					  char *buf, size_t size,
+					  struct eembed_serial *serial,
+					  unsigned char non_blocking)
+{
+	if (!ctx || !serial || !serial->write
+	    || (non_blocking && !serial->available_for_write)
+	    || !eembed_buffered_log_init(log, &ctx->out, buf, size,
+					 eembed_serial_log_write, ctx)) {
+		return NULL;
+	}
+	ctx->out.flush_on_eol = 1;
+	ctx->serial = serial;
+	ctx->non_blocking = non_blocking;
+	ctx->dropped = 0;
+	ctx->dropping = 0;
+
+	return log;
+}
+
+#if Eembed_use_ring_log
+struct eembed_ring_log_line {
+	struct eembed_ring_log *ring;
+	size_t len;
+	unsigned char truncated;
+	char bytes[Eembed_ring_log_line_size];
+};
+
+static EEMBED_THREAD_LOCAL struct eembed_ring_log_line eembed_ring_log_pending;
+
+static void eembed_ring_log_push(struct eembed_ring_log_line *pending)
+{
+	struct eembed_ring_log *ring = pending->ring;
+	struct eembed_ring_log_slot *slot = NULL;
+	size_t pos = 0;
+	size_t seq = 0;
+
+	if (pending->truncated) {
+		__atomic_add_fetch(&ring->truncated, 1, __ATOMIC_RELAXED);
+	}
+	pending->bytes[pending->len] = '\0';
+	pending->len = 0;
+	pending->truncated = 0;
+
+	if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	/* claim the slot at the tail, unless it has not yet been drained */
+	do {
+		pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		slot = ring->slots + (pos & ring->mask);
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if ((ssize_t)(seq - pos) < 0) {
+			if (ring->full && ring->full(ring)) {
+				continue;
+			}
+			__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while (seq != pos
+		 || !__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 0,
+						 __ATOMIC_RELAXED,
+						 __ATOMIC_RELAXED));
+
+	eembed_strcpy(slot->line, pending->bytes);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	if (ring->pushed) {
+		ring->pushed(ring);
+	}
+}
+
+void eembed_ring_log_append_n(struct eembed_log *log, const char *bytes,
+			      size_t len)
+{
+	struct eembed_ring_log_line *pending = &eembed_ring_log_pending;
+	struct eembed_ring_log *ring = NULL;
+	size_t avail = 0;
+
+	ring = (struct eembed_ring_log *)log->context;
+	if (pending->ring != ring) {
+		if (pending->len) {
+			eembed_ring_log_push(pending);
+		}
+		pending->ring = ring;
+	}
+	if (!bytes) {
+		return;
+	}
+
+	avail = (Eembed_ring_log_line_size - 1) - pending->len;
+	if (len > avail) {
+		len = avail;
+		pending->truncated = 1;
+	}
+	eembed_memcpy(pending->bytes + pending->len, bytes, len);
+	pending->len += len;
+}
+
+void eembed_ring_log_append_s(struct eembed_log *log, const char *str)
+{
+	size_t len = 0;
+
+	/* a string longer than the line will be truncated anyway */
+	len = str ? eembed_strnlen(str, Eembed_ring_log_line_size) : 0;
+	eembed_ring_log_append_n(log, str, len);
+}
+
+void eembed_ring_log_append_eol(struct eembed_log *log)
+{
+	struct eembed_ring_log_line *pending = &eembed_ring_log_pending;
+
+	eembed_ring_log_append_s(log, NULL);
+	eembed_ring_log_push(pending);
+}
+
+/* non-zero if the line at the head is ready to be drained */
+static int eembed_ring_log_ready(struct eembed_ring_log *ring)
+{
+	struct eembed_ring_log_slot *slot = NULL;
+
+	slot = ring->slots + (ring->head & ring->mask);
+	return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == ring->head + 1;
+}
+
+size_t eembed_ring_log_drain(struct eembed_ring_log *ring)
+{
+	struct eembed_ring_log_slot *slot = NULL;
+	size_t lines = 0;
+
+	for (;;) {
+		if (!eembed_ring_log_ready(ring)) {
+			return lines;
+		}
+		slot = ring->slots + (ring->head & ring->mask);
+		ring->sink->append_s(ring->sink, slot->line);
+		ring->sink->append_eol(ring->sink);
+		__atomic_store_n(&slot->seq, ring->head + ring->mask + 1,
+				 __ATOMIC_RELEASE);
+		++ring->head;
+		++lines;
+	}
+}
+
+static void eembed_ring_log_flush_hook(void *context)
+{
+	eembed_ring_log_drain((struct eembed_ring_log *)context);
+}
+
+struct eembed_log *eembed_ring_log_init(struct eembed_log *log,
+					struct eembed_ring_log *ring,
+					struct eembed_ring_log_slot *slots,
+					size_t slots_len,
+					struct eembed_log *sink)
+{
+	size_t i = 0;
+
+	if (!log || !ring || !slots || !slots_len || !sink) {
+		return NULL;
+	}
+
+	/* round down to a power of two */
+	while (slots_len & (slots_len - 1)) {
+		slots_len = slots_len & (slots_len - 1);
+	}
+	for (i = 0; i < slots_len; ++i) {
+		slots[i].seq = i;
+	}
+	ring->slots = slots;
+	ring->mask = slots_len - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->dropped = 0;
+	ring->truncated = 0;
+	ring->sink = sink;
+	ring->flush_hook.flush = eembed_ring_log_flush_hook;
+	ring->flush_hook.context = ring;
+	ring->flush_hook.next = NULL;
+	ring->full = NULL;
+	ring->pushed = NULL;
+	ring->closed = 0;
+
+	log->context = ring;
+	log->append_c = eembed_log_str_append_c;
+	log->append_s = eembed_ring_log_append_s;
+	log->append_n = eembed_ring_log_append_n;
+	log->append_fill = eembed_log_str_append_fill;
+	log->append_ul = eembed_log_str_append_ul;
+	log->append_l = eembed_log_str_append_l;
+	log->append_f = eembed_log_str_append_f;
+	log->append_fd = eembed_log_str_append_fd;
+	log->append_vp = eembed_log_str_append_vp;
+	log->append_eol = eembed_ring_log_append_eol;
+
+	return log;
+}
+#endif /* Eembed_use_ring_log */
+
+#if Eembed_use_async_log
+/* function pointer for pthread_create, to allow testing of failure */
+int (*eembed_pthread_create)(pthread_t *thread, const pthread_attr_t *attr,
+			     void *(*start)(void *), void *arg) =
+    pthread_create;
+
+/* The writer sleeps only when the ring is empty. Before sleeping, it sets
+ * "writer_waiting" then checks the ring once more; a logging thread adds a
+ * line then checks "writer_waiting". With a full fence between each store
+ * and load, at least one of the two sees the other, thus either the writer
+ * finds the line, or the logging thread wakes the writer. */
+static void *eembed_async_log_writer(void *arg)
+{
+	struct eembed_async_log *ctx = (struct eembed_async_log *)arg;
+	size_t lines = 0;
+
+	pthread_mutex_lock(&ctx->mutex);
+	while (ctx->running) {
+		pthread_mutex_unlock(&ctx->mutex);
+		lines = eembed_ring_log_drain(&ctx->ring);
+		pthread_mutex_lock(&ctx->mutex);
+		if (lines) {
+			pthread_cond_broadcast(&ctx->wake_producers);
+		} else if (ctx->running) {
+			__atomic_store_n(&ctx->writer_waiting, 1,
+					 __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			if (!eembed_ring_log_ready(&ctx->ring)) {
+				pthread_cond_wait(&ctx->wake_writer,
+						  &ctx->mutex);
+			}
+			__atomic_store_n(&ctx->writer_waiting, 0,
+					 __ATOMIC_RELAXED);
+		}
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+
+	eembed_ring_log_drain(&ctx->ring);
+	return NULL;
+}
+
+static void eembed_async_log_pushed(struct eembed_ring_log *ring)
+{
+	struct eembed_async_log *ctx = (struct eembed_async_log *)ring;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ctx->writer_waiting, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock(&ctx->mutex);
+		pthread_cond_signal(&ctx->wake_writer);
+		pthread_mutex_unlock(&ctx->mutex);
+	}
+}
+
+/* The writer broadcasts "wake_producers" with the mutex held, after each
+ * drain, thus checking for a free slot with the mutex held, before waiting,
+ * can not miss the broadcast. */
+static int eembed_async_log_full(struct eembed_ring_log *ring)
+{
+	struct eembed_async_log *ctx = (struct eembed_async_log *)ring;
+	struct eembed_ring_log_slot *slot = NULL;
+	size_t pos = 0;
+	int retry = 0;
+
+	pthread_mutex_lock(&ctx->mutex);
+	retry = ctx->running;
+	if (retry) {
+		pthread_cond_signal(&ctx->wake_writer);
+		pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		slot = ring->slots + (pos & ring->mask);
+		if ((ssize_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE)
+			      - pos) < 0) {
+			pthread_cond_wait(&ctx->wake_producers, &ctx->mutex);
+		}
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+	return retry;
+}
+
+static void eembed_async_log_destroy(struct eembed_async_log *ctx)
 {
-	log->append_s(log, "\n");
+	pthread_cond_destroy(&ctx->wake_producers);
+	pthread_cond_destroy(&ctx->wake_writer);
+	pthread_mutex_destroy(&ctx->mutex);
+	ctx->started = 0;
 }
 
-struct eembed_log *eembed_char_buf_log_init(struct eembed_log *log,
-					    struct eembed_str_buf *ctx,
-					    char *buf, size_t size)
+void eembed_async_log_stop(struct eembed_async_log *ctx)
 {
-	if (!log) {
-		return NULL;
+	if (!ctx->started) {
+		return;
 	}
 
-	log->context = ctx;
-	log->append_c = eembed_log_str_append_c;
-	log->append_s = eembed_log_strbuf_append_s;
-	log->append_ul = eembed_log_str_append_ul;
-	log->append_l = eembed_log_str_append_l;
-	log->append_f = eembed_log_str_append_f;
-	log->append_fd = eembed_log_str_append_fd;
-	log->append_vp = eembed_log_str_append_vp;
-	log->append_eol = eembed_log_str_append_eol;
+	pthread_mutex_lock(&ctx->mutex);
+	__atomic_store_n(&ctx->ring.closed, 1, __ATOMIC_RELEASE);
+	ctx->running = 0;
+	ctx->ring.full = NULL;
+	ctx->ring.pushed = NULL;
+	pthread_cond_signal(&ctx->wake_writer);
+	pthread_cond_broadcast(&ctx->wake_producers);
+	pthread_mutex_unlock(&ctx->mutex);
+
+	eembed_flush_hook_remove(&ctx->flush_hook);
+	if (pthread_equal(pthread_self(), ctx->writer)) {
+		/* the writer still holds the ring (and will take the mutex),
+		 * it exits when the call which stopped it returns */
+		pthread_detach(ctx->writer);
+		ctx->started = 0;
+		return;
+	}
+	pthread_join(ctx->writer, NULL);
+	eembed_async_log_destroy(ctx);
+}
 
-	if (!log->context) {
+static void eembed_async_log_flush_hook(void *context)
+{
+	eembed_async_log_stop((struct eembed_async_log *)context);
+}
+
+struct eembed_log *eembed_async_log_start(struct eembed_log *log,
+					  struct eembed_async_log *ctx,
+					  struct eembed_ring_log_slot *slots,
+					  size_t slots_len,
+					  struct eembed_log *sink,
+					  unsigned char block_when_full)
+{
+	if (!ctx || !eembed_ring_log_init(log, &ctx->ring, slots, slots_len,
+					  sink)) {
 		return NULL;
 	}
-
-	ctx->buf = buf;
-	if (!ctx->buf) {
-		ctx->size = 0;
+	ctx->block_when_full = block_when_full;
+	ctx->ring.full = block_when_full ? eembed_async_log_full : NULL;
+	ctx->ring.pushed = eembed_async_log_pushed;
+	ctx->running = 1;
+	ctx->writer_waiting = 0;
+	ctx->started = 1;
+	pthread_mutex_init(&ctx->mutex, NULL);
+	pthread_cond_init(&ctx->wake_writer, NULL);
+	pthread_cond_init(&ctx->wake_producers, NULL);
+
+	if (eembed_pthread_create(&ctx->writer, NULL, eembed_async_log_writer,
+				  ctx)) {
+		ctx->running = 0;
+		ctx->ring.full = NULL;
+		ctx->ring.pushed = NULL;
+		eembed_async_log_destroy(ctx);
 		return NULL;
 	}
 
-	ctx->size = size;
+	ctx->flush_hook.flush = eembed_async_log_flush_hook;
+	ctx->flush_hook.context = ctx;
+	ctx->flush_hook.next = NULL;
+	eembed_flush_hook_add(&ctx->flush_hook);
 
-	return ctx->size ? log : NULL;
+	return log;
 }
+#endif /* Eembed_use_async_log */
 
 int eembed_strcpy_safe(char *buf, size_t size, const char *str)
 {
@@ -278,6 +1864,20 @@ void eembed_fprintf_append_s(struct eembed_log *log, const char *str)
 	eembed_fprintf(stream, "%s", str);
 }
 
+void eembed_fprintf_append_n(struct eembed_log *log, const char *bytes,
+			     size_t len)
+{
+	FILE *stream = eembed_log_get_stream_from_context(log);
+	size_t n = 0;
+
+	while (bytes && len) {
+		n = (len < INT_MAX) ? len : INT_MAX;
+		eembed_fprintf(stream, "%.*s", (int)n, bytes);
+		bytes += n;
+		len -= n;
+	}
+}
+
 void eembed_fprintf_append_ul(struct eembed_log *log, uint64_t ul)
 {
 	FILE *stream = eembed_log_get_stream_from_context(log);
@@ -329,7 +1929,9 @@ struct eembed_log eembed_stderr_log = {
 	eembed_fprintf_append_f,
 	eembed_fprintf_append_fd,
 	eembed_fprintf_append_vp,
-	eembed_fprintf_append_eol
+	eembed_fprintf_append_eol,
+	eembed_fprintf_append_n,
+	eembed_log_str_append_fill
 };
 
 struct eembed_log *eembed_err_log = &eembed_stderr_log;
@@ -343,11 +1945,341 @@ struct eembed_log eembed_stdout_log = {
 	eembed_fprintf_append_f,
 	eembed_fprintf_append_fd,
 	eembed_fprintf_append_vp,
-	eembed_fprintf_append_eol
+	eembed_fprintf_append_eol,
+	eembed_fprintf_append_n,
+	eembed_log_str_append_fill
 };
 
 struct eembed_log *eembed_out_log = &eembed_stdout_log;
 
+void eembed_stdio_write(void *sink, const char *bytes, size_t len)
+{
+	struct eembed_function_context *ctx = NULL;
+	FILE *stream = NULL;
+
+	ctx = (struct eembed_function_context *)sink;
+	stream = (FILE *)ctx->func(ctx->data);
+	fwrite(bytes, 1, len, stream);
+}
+
+#if Eembed_use_fd_log
+/* function pointer for writev, to allow testing of short writes */
+ssize_t (*eembed_writev)(int fd, const struct iovec *iov, int iovcnt) = writev;
+
+static void eembed_fd_writev(int fd, struct iovec *iov, int iovcnt)
+{
+	int saved_errno = errno;
+	ssize_t written = 0;
+	size_t len = 0;
+
+	while (iovcnt) {
+		written = eembed_writev(fd, iov, iovcnt);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			break;
+		}
+		len = (size_t)written;
+		while (iovcnt && len >= iov->iov_len) {
+			len -= iov->iov_len;
+			++iov;
+			--iovcnt;
+		}
+		if (iovcnt) {
+			iov->iov_base = ((char *)iov->iov_base) + len;
+			iov->iov_len -= len;
+		}
+	}
+	errno = saved_errno;
+}
+
+void eembed_fd_write(void *sink, const char *bytes, size_t len)
+{
+	struct iovec iov[1];
+
+	iov[0].iov_base = eembed_ignore_const_s(bytes);
+	iov[0].iov_len = len;
+	eembed_fd_writev(*((int *)sink), iov, 1);
+}
+
+static void eembed_fd_log_append(struct eembed_buffered_log *ctx,
+				 const char *bytes, size_t len)
+{
+	struct iovec iov[2];
+
+	if (ctx->buf && len <= (ctx->size - ctx->used)) {
+		eembed_memcpy(ctx->buf + ctx->used, bytes, len);
+		ctx->used += len;
+		return;
+	}
+
+	iov[0].iov_base = ctx->buf;
+	iov[0].iov_len = ctx->used;
+	iov[1].iov_base = eembed_ignore_const_s(bytes);
+	iov[1].iov_len = len;
+	eembed_fd_writev(*((int *)ctx->sink), iov, 2);
+	ctx->used = 0;
+}
+
+void eembed_fd_log_append_s(struct eembed_log *log, const char *str)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	if (str) {
+		eembed_fd_log_append(ctx, str, eembed_strlen(str));
+	}
+}
+
+void eembed_fd_log_append_n(struct eembed_log *log, const char *bytes,
+			    size_t len)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	if (bytes) {
+		eembed_fd_log_append(ctx, bytes, len);
+	}
+}
+
+void eembed_fd_log_append_c(struct eembed_log *log, char c)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	eembed_fd_log_append(ctx, &c, 1);
+}
+
+void eembed_fd_log_append_ul(struct eembed_log *log, uint64_t ul)
+{
+	char str[25] = { '\0' };
+	eembed_diy_ulong_to_str(str, sizeof(str), ul);
+	eembed_fd_log_append_s(log, str);
+}
+
+void eembed_fd_log_append_l(struct eembed_log *log, int64_t l)
+{
+	char str[25] = { '\0' };
+	eembed_diy_long_to_str(str, sizeof(str), l);
+	eembed_fd_log_append_s(log, str);
+}
+
+void eembed_fd_log_append_f(struct eembed_log *log, long double f)
+{
+	char str[25] = { '\0' };
+	eembed_diy_float_to_str(str, sizeof(str), f);
+	eembed_fd_log_append_s(log, str);
+}
+
+void eembed_fd_log_append_fd(struct eembed_log *log, long double f, uint8_t d)
+{
+	char str[25] = { '\0' };
+	eembed_diy_float_fraction_to_str(str, sizeof(str), f, d);
+	eembed_fd_log_append_s(log, str);
+}
+
+void eembed_fd_log_append_vp(struct eembed_log *log, const void *ptr)
+{
+	char str[25] = { '\0' };
+	eembed_diy_ulong_to_hex(str, sizeof(str), (size_t)ptr);
+	eembed_fd_log_append_s(log, str);
+}
+
+void eembed_fd_log_append_eol(struct eembed_log *log)
+{
+	struct eembed_buffered_log *ctx = NULL;
+
+	ctx = (struct eembed_buffered_log *)log->context;
+	eembed_fd_log_append(ctx, "\n", 1);
+	if (ctx->flush_on_eol) {
+		eembed_buffered_log_flush(ctx);
+	}
+}
+
+struct eembed_log *eembed_fd_log_init(struct eembed_log *log,
+				      struct eembed_buffered_log *ctx,
+				      char *buf, size_t size, int *fd)
+{
+	if (!fd || !eembed_buffered_log_init(log, ctx, buf, size,
+					     eembed_fd_write, fd)) {
+		return NULL;
+	}
+
+	log->append_c = eembed_fd_log_append_c;
+	log->append_s = eembed_fd_log_append_s;
+	log->append_n = eembed_fd_log_append_n;
+	log->append_fill = eembed_log_str_append_fill;
+	log->append_ul = eembed_fd_log_append_ul;
+	log->append_l = eembed_fd_log_append_l;
+	log->append_f = eembed_fd_log_append_f;
+	log->append_fd = eembed_fd_log_append_fd;
+	log->append_vp = eembed_fd_log_append_vp;
+	log->append_eol = eembed_fd_log_append_eol;
+
+	return log;
+}
+#endif /* Eembed_use_fd_log */
+
+#if Eembed_use_mmap_log
+/* the file descriptor is not leaked into programs started with exec */
+#ifdef O_CLOEXEC
+#define Eembed_o_cloexec O_CLOEXEC
+#else
+#define Eembed_o_cloexec 0
+#endif
+
+/* function pointer for mmap, to allow testing of failure */
+void *(*eembed_mmap)(void *addr, size_t len, int prot, int flags, int fd,
+		     off_t offset) = mmap;
+
+/* grows the file and the mapping to hold at least "needed" bytes */
+static int eembed_mmap_log_grow(struct eembed_mmap_log *ctx, size_t needed)
+{
+	size_t size = 0;
+	void *map = MAP_FAILED;
+
+	size = ((needed + ctx->grow_by - 1) / ctx->grow_by) * ctx->grow_by;
+	if (ctx->map) {
+		munmap(ctx->map, ctx->mapped);
+	}
+	if (ftruncate(ctx->fd, (off_t)size)
+	    || (map = eembed_mmap(NULL, size, PROT_READ | PROT_WRITE,
+				  MAP_SHARED, ctx->fd, 0)) == MAP_FAILED) {
+		/* the bytes already logged are still in the file */
+		ctx->map = NULL;
+		ctx->mapped = 0;
+		return -1;
+	}
+	ctx->map = (char *)map;
+	ctx->mapped = size;
+	return 0;
+}
+
+static void eembed_mmap_log_append(struct eembed_mmap_log *ctx,
+				   const char *bytes, char c, size_t len)
+{
+	/* after a failed re-map, "mapped" may be less than "used" */
+	if (((ctx->used + len) > ctx->mapped)
+	    && eembed_mmap_log_grow(ctx, ctx->used + len)) {
+		return;
+	}
+	if (bytes) {
+		eembed_memcpy(ctx->map + ctx->used, bytes, len);
+	} else {
+		eembed_memset(ctx->map + ctx->used, c, len);
+	}
+	ctx->used += len;
+}
+
+void eembed_mmap_log_append_n(struct eembed_log *log, const char *bytes,
+			      size_t len)
+{
+	if (bytes) {
+		eembed_mmap_log_append((struct eembed_mmap_log *)log->context,
+				       bytes, '\0', len);
+	}
+}
+
+void eembed_mmap_log_append_s(struct eembed_log *log, const char *str)
+{
+	eembed_mmap_log_append_n(log, str, str ? eembed_strlen(str) : 0);
+}
+
+void eembed_mmap_log_append_c(struct eembed_log *log, char c)
+{
+	eembed_mmap_log_append_n(log, &c, 1);
+}
+
+void eembed_mmap_log_append_fill(struct eembed_log *log, char c,
+				 size_t count)
+{
+	eembed_mmap_log_append((struct eembed_mmap_log *)log->context, NULL,
+			       c, count);
+}
+
+void eembed_mmap_log_append_eol(struct eembed_log *log)
+{
+	eembed_mmap_log_append_n(log, "\n", 1);
+}
+
+int eembed_mmap_log_flush(struct eembed_mmap_log *ctx)
+{
+	if (ctx->fd < 0) {
+		return 0;
+	}
+	/* the mapping may not reach past the end of the trimmed file, thus
+	 * it is dropped; the next append grows the file and re-maps it */
+	if (ctx->map) {
+		munmap(ctx->map, ctx->mapped);
+		ctx->map = NULL;
+		ctx->mapped = 0;
+	}
+	return ftruncate(ctx->fd, (off_t)ctx->used) ? -1 : 0;
+}
+
+static void eembed_mmap_log_flush_hook(void *context)
+{
+	eembed_mmap_log_flush((struct eembed_mmap_log *)context);
+}
+
+struct eembed_log *eembed_mmap_log_open(struct eembed_log *log,
+					struct eembed_mmap_log *ctx,
+					const char *path, size_t grow_by)
+{
+	if (!log || !ctx || !path) {
+		return NULL;
+	}
+
+	ctx->map = NULL;
+	ctx->mapped = 0;
+	ctx->used = 0;
+	ctx->grow_by = grow_by ? grow_by : (1024 * 1024);
+	ctx->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | Eembed_o_cloexec,
+		       0644);
+	if (ctx->fd < 0) {
+		return NULL;
+	}
+	if (eembed_mmap_log_grow(ctx, ctx->grow_by)) {
+		close(ctx->fd);
+		ctx->fd = -1;
+		return NULL;
+	}
+	ctx->flush_hook.flush = eembed_mmap_log_flush_hook;
+	ctx->flush_hook.context = ctx;
+	ctx->flush_hook.next = NULL;
+	eembed_flush_hook_add(&ctx->flush_hook);
+
+	log->context = ctx;
+	log->append_c = eembed_mmap_log_append_c;
+	log->append_s = eembed_mmap_log_append_s;
+	log->append_n = eembed_mmap_log_append_n;
+	log->append_fill = eembed_mmap_log_append_fill;
+	log->append_ul = eembed_log_str_append_ul;
+	log->append_l = eembed_log_str_append_l;
+	log->append_f = eembed_log_str_append_f;
+	log->append_fd = eembed_log_str_append_fd;
+	log->append_vp = eembed_log_str_append_vp;
+	log->append_eol = eembed_mmap_log_append_eol;
+
+	return log;
+}
+
+int eembed_mmap_log_close(struct eembed_mmap_log *ctx)
+{
+	int err = 0;
+
+	if (ctx->fd < 0) {
+		return 0;
+	}
+	eembed_flush_hook_remove(&ctx->flush_hook);
+	err = eembed_mmap_log_flush(ctx);
+	err = close(ctx->fd) || err;
+	ctx->fd = -1;
+	return err ? -1 : 0;
+}
+#endif /* Eembed_use_mmap_log */
+
 char *eembed_sprintf_long_to_str(char *buf, size_t size, int64_t l)
 {
 	int written = buf ? snprintf(buf, size, "%" PRId64, l) : -1;
@@ -410,7 +2342,8 @@ char *eembed_diy_long_to_str(char *buf, size_t size, int64_t l)
 		buf[0] = '-';
 		b = buf + 1;
 		bsize = size - 1;
-		ul = (-l);
+		/* negated as unsigned, as the most negative has no positive */
+		ul = 0 - (uint64_t)l;
 	} else {
 		b = buf;
 		bsize = size;
@@ -657,19 +2590,6 @@ char *eembed_bytes_to_hex(char *buf, size_t buf_len, unsigned char *bytes,
 	return buf;
 }
 
-#if __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-qual"
-#endif
-static char *eembed_ignore_const_s(const char *str)
-{
-	return (char *)(str);
-}
-
-#if __GNUC__
-#pragma GCC diagnostic pop
-#endif
-
 uint64_t eembed_diy_str_to_u64(const char *str, char **endptr, int pbase)
 {
 	uint64_t base = (uint64_t)pbase;
@@ -739,28 +2659,53 @@ int64_t eembed_diy_str_to_i64(const char *str, char **endptr, int base)
 	return negate ? -val : val;
 }
 
+EEMBED_THREAD_LOCAL struct eembed_alloc_site eembed_alloc_site = {
+	NULL, 0, NULL
+};
+
+#if __GNUC__
+#define eembed_alloc_site_begin() \
+	(eembed_alloc_site.caller = __builtin_return_address(0))
+#else
+#define eembed_alloc_site_begin() (eembed_alloc_site.caller = NULL)
+#endif
+
+static void *eembed_alloc_site_end(void *ptr)
+{
+	eembed_alloc_site.file = NULL;
+	eembed_alloc_site.line = 0;
+	eembed_alloc_site.caller = NULL;
+	return ptr;
+}
+
 void *eembed_malloc(size_t size)
 {
 	struct eembed_allocator *ea = eembed_global_allocator;
-	return ea ? ea->malloc(ea, size) : NULL;
+	eembed_alloc_site_begin();
+	return eembed_alloc_site_end(ea ? ea->malloc(ea, size) : NULL);
 }
 
 void *eembed_realloc(void *ptr, size_t size)
 {
 	struct eembed_allocator *ea = eembed_global_allocator;
-	return ea ? ea->realloc(ea, ptr, size) : NULL;
+	eembed_alloc_site_begin();
+	return eembed_alloc_site_end(ea ? ea->realloc(ea, ptr, size) : NULL);
 }
 
 void *eembed_calloc(size_t nmemb, size_t size)
 {
 	struct eembed_allocator *ea = eembed_global_allocator;
-	return ea ? ea->calloc(ea, nmemb, size) : NULL;
+	eembed_alloc_site_begin();
+	return eembed_alloc_site_end(ea ? ea->calloc(ea, nmemb, size) : NULL);
 }
 
 void *eembed_reallocarray(void *ptr, size_t nmemb, size_t size)
 {
 	struct eembed_allocator *ea = eembed_global_allocator;
-	return ea ? ea->reallocarray(ea, ptr, nmemb, size) : NULL;
+	eembed_alloc_site_begin();
+	return eembed_alloc_site_end(ea ?
+				     ea->reallocarray(ea, ptr, nmemb, size) :
+				     NULL);
 }
 
 void eembed_free(void *ptr)
@@ -797,59 +2742,239 @@ int eembed_diy_memcmp(const void *a1, const void *a2, size_t n)
 	return 0;
 }
 
+/* The word-at-a-time functions read and write memory of any type as words,
+ * thus (with GCC) the word type may alias anything. Typically the size of a
+ * size_t is the EEMBED_WORD_LEN. */
+#if __GNUC__
+typedef size_t __attribute__((__may_alias__)) eembed_word_t;
+#else
+typedef size_t eembed_word_t;
+#endif
+
+/* An aligned read can not cross a page boundary, thus scanning a string by
+ * aligned words (or vectors) can not fault, but may read past the end of
+ * the string object; such functions are not checked by AddressSanitizer. */
+#if ((__GNUC__ >= 5) || defined(__clang__))
+#define Eembed_no_sanitize_address __attribute__((no_sanitize_address))
+#else
+#define Eembed_no_sanitize_address
+#endif
+
+#define eembed_word_len (sizeof(eembed_word_t))
+#define eembed_word_offset(p) (((size_t)(p)) & (eembed_word_len - 1))
+
+/* 0x0101..01 and 0x8080..80 */
+#define eembed_word_ones (((eembed_word_t)-1) / 0xFF)
+#define eembed_word_highs (eembed_word_ones << 7)
+
+/* non-zero if any byte of the word is zero: subtracting one from each byte
+ * only sets the high bit of a byte which was zero or had the high bit set,
+ * and the "& ~w" excludes those with the high bit set */
+#define eembed_word_has_zero(w) \
+	(((w) - eembed_word_ones) & ~(w) & eembed_word_highs)
+
+/* copies forward: if the source and destination can both be word aligned,
+ * the bytes before the first aligned word and after the last are copied one
+ * at a time, and the rest a word at a time */
+static void eembed_diy_copy_forward(unsigned char *dest,
+				    const unsigned char *src, size_t n)
+{
+	const eembed_word_t *ws;
+	eembed_word_t *wd;
+
+	if (n >= (2 * eembed_word_len)
+	    && eembed_word_offset(dest) == eembed_word_offset(src)) {
+		while (eembed_word_offset(dest)) {
+			*dest++ = *src++;
+			--n;
+		}
+		while (n >= (4 * eembed_word_len)) {
+			wd = (eembed_word_t *)dest;
+			ws = (const eembed_word_t *)src;
+			wd[0] = ws[0];
+			wd[1] = ws[1];
+			wd[2] = ws[2];
+			wd[3] = ws[3];
+			dest += (4 * eembed_word_len);
+			src += (4 * eembed_word_len);
+			n -= (4 * eembed_word_len);
+		}
+		while (n >= eembed_word_len) {
+			wd = (eembed_word_t *)dest;
+			*wd = *((const eembed_word_t *)src);
+			dest += eembed_word_len;
+			src += eembed_word_len;
+			n -= eembed_word_len;
+		}
+	}
+	while (n--) {
+		*dest++ = *src++;
+	}
+}
+
+/* copies backward, from the end, for an overlapping move to a later address */
+static void eembed_diy_copy_backward(unsigned char *dest,
+				     const unsigned char *src, size_t n)
+{
+	eembed_word_t *wd;
+
+	dest += n;
+	src += n;
+	if (n >= (2 * eembed_word_len)
+	    && eembed_word_offset(dest) == eembed_word_offset(src)) {
+		while (eembed_word_offset(dest)) {
+			*--dest = *--src;
+			--n;
+		}
+		while (n >= eembed_word_len) {
+			dest -= eembed_word_len;
+			src -= eembed_word_len;
+			n -= eembed_word_len;
+			wd = (eembed_word_t *)dest;
+			*wd = *((const eembed_word_t *)src);
+		}
+	}
+	while (n--) {
+		*--dest = *--src;
+	}
+}
+
 void *eembed_diy_memmove(void *d, const void *s, size_t n)
 {
 	const unsigned char *src = (const unsigned char *)s;
 	unsigned char *dest = (unsigned char *)d;
-	size_t i;
 
 	if (src < dest && dest < src + n) {
-		for (i = n; i; i--) {
-			dest[i - 1] = src[i - 1];
-		}
+		eembed_diy_copy_backward(dest, src, n);
 	} else {
-		for (i = 0; i < n; ++i) {
-			dest[i] = src[i];
-		}
+		eembed_diy_copy_forward(dest, src, n);
 	}
 	return d;
 }
 
+/* the regions must not overlap, thus it is always safe to copy forward */
 void *eembed_diy_memcpy(void *d, const void *s, size_t n)
 {
-	return eembed_diy_memmove(d, s, n);
+	eembed_diy_copy_forward((unsigned char *)d, (const unsigned char *)s,
+				n);
+	return d;
 }
 
 void *eembed_diy_memset(void *dest, int val, size_t n)
 {
 	unsigned char *d;
 	unsigned char v;
+	eembed_word_t w;
+
 	if (!n || !dest) {
 		return dest;
 	}
-
-	d = (unsigned char *)dest;
-	v = (unsigned char)val;
+
+	d = (unsigned char *)dest;
+	v = (unsigned char)val;
+	if (n >= (2 * eembed_word_len)) {
+		/* the byte in each byte of the word */
+		w = eembed_word_ones * v;
+		while (eembed_word_offset(d)) {
+			*d++ = v;
+			--n;
+		}
+		while (n >= (4 * eembed_word_len)) {
+			((eembed_word_t *)d)[0] = w;
+			((eembed_word_t *)d)[1] = w;
+			((eembed_word_t *)d)[2] = w;
+			((eembed_word_t *)d)[3] = w;
+			d += (4 * eembed_word_len);
+			n -= (4 * eembed_word_len);
+		}
+		while (n >= eembed_word_len) {
+			*((eembed_word_t *)d) = w;
+			d += eembed_word_len;
+			n -= eembed_word_len;
+		}
+	}
+	while (n--) {
+		*d++ = v;
+	}
+
+	return dest;
+}
+
+/* as with strnlen, whole words are only read once aligned */
+void *eembed_diy_memchr(const void *s, int c, size_t n)
+{
+	const unsigned char *p;
+	unsigned char ch;
+	eembed_word_t pattern, w;
+
+	p = (const unsigned char *)s;
+	ch = (unsigned char)c;
+	while (n && eembed_word_offset(p)) {
+		if (*p == ch) {
+			return eembed_ignore_const_s((const char *)p);
+		}
+		++p;
+		--n;
+	}
+	pattern = eembed_word_ones * ch;
+	while (n >= eembed_word_len) {
+		w = *((const eembed_word_t *)p) ^ pattern;
+		if (eembed_word_has_zero(w)) {
+			break;
+		}
+		p += eembed_word_len;
+		n -= eembed_word_len;
+	}
+	for (; n; --n, ++p) {
+		if (*p == ch) {
+			return eembed_ignore_const_s((const char *)p);
+		}
+	}
+	return NULL;
+}
+
+void *eembed_diy_memrchr(const void *s, int c, size_t n)
+{
+	const unsigned char *p;
+	unsigned char ch;
+	eembed_word_t pattern, w;
+
+	p = ((const unsigned char *)s) + n;
+	ch = (unsigned char)c;
+	while (n && eembed_word_offset(p)) {
+		--p;
+		--n;
+		if (*p == ch) {
+			return eembed_ignore_const_s((const char *)p);
+		}
+	}
+	pattern = eembed_word_ones * ch;
+	while (n >= eembed_word_len) {
+		w = *((const eembed_word_t *)(p - eembed_word_len)) ^ pattern;
+		if (eembed_word_has_zero(w)) {
+			break;
+		}
+		p -= eembed_word_len;
+		n -= eembed_word_len;
+	}
 	while (n--) {
-		d[n] = v;
+		--p;
+		if (*p == ch) {
+			return eembed_ignore_const_s((const char *)p);
+		}
 	}
-
-	return dest;
+	return NULL;
 }
 
-#if __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstringop-overflow"
-#endif
+/* src is walked only once, as it is copied */
 char *eembed_diy_strcat(char *dest, const char *src)
 {
+	eembed_assert(dest);
 	eembed_assert(src);
-	return eembed_strncat(dest, src, eembed_strlen(src) + 1);
-}
 
-#if __GNUC__
-#pragma GCC diagnostic pop
-#endif
+	eembed_diy_stpcpy(dest + eembed_strlen(dest), src);
+	return dest;
+}
 
 /*
 	If src contains n or more bytes, strncat() writes n+1 bytes to dest
@@ -873,7 +2998,23 @@ char *eembed_diy_strncat(char *dest, const char *src, size_t n)
 
 int eembed_diy_strcmp(const char *s1, const char *s2)
 {
-	return eembed_strncmp(s1, s2, 1 + eembed_strlen(s1));
+	size_t i;
+	int d;
+
+	eembed_assert(s1);
+	eembed_assert(s2);
+
+	if (s1 == s2) {
+		return 0;
+	}
+
+	for (i = 0; s1[i] != '\0'; ++i) {
+		d = s1[i] - s2[i];
+		if (d) {
+			return d;
+		}
+	}
+	return s1[i] - s2[i];
 }
 
 int eembed_diy_strncmp(const char *s1, const char *s2, size_t max_len)
@@ -900,20 +3041,48 @@ int eembed_diy_strncmp(const char *s1, const char *s2, size_t max_len)
 	return 0;
 }
 
-#if __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstringop-overflow"
-#pragma GCC diagnostic ignored "-Wstringop-truncation"
-#endif
 char *eembed_diy_strcpy(char *dest, const char *src)
 {
+	eembed_diy_stpcpy(dest, src);
+	return dest;
+}
+
+/* like strcpy, but returns a pointer to the NULL terminator written to
+ * dest, thus a string may be built by chaining calls without rescanning */
+char *eembed_diy_stpcpy(char *dest, const char *src)
+{
+	/* glibc crashes on NULL */
+	eembed_assert(dest);
 	eembed_assert(src);
-	return eembed_strncpy(dest, src, 1 + eembed_strlen(src));
+
+	while ((*dest = *src++) != '\0') {
+		++dest;
+	}
+	return dest;
 }
 
-#if __GNUC__
-#pragma GCC diagnostic pop
-#endif
+/* Copies as much of src as fits, always NULL terminating if size is not
+ * zero. Returns the length of src: if the return is size or more, the
+ * copy was truncated. Only the part of src which does not fit is measured
+ * after the copy. */
+size_t eembed_diy_strlcpy(char *dest, const char *src, size_t size)
+{
+	size_t i = 0;
+
+	eembed_assert(src);
+	eembed_assert(dest || !size);
+
+	if (size) {
+		for (; i < (size - 1) && src[i] != '\0'; ++i) {
+			dest[i] = src[i];
+		}
+		dest[i] = '\0';
+	}
+	if (src[i] == '\0') {
+		return i;
+	}
+	return i + eembed_strlen(src + i);
+}
 
 /*
    If the length of src is less than n, strncpy() writes additional null
@@ -937,11 +3106,34 @@ char *eembed_diy_strncpy(char *dest, const char *src, size_t n)
 	return dest;
 }
 
+/* from the aligned "i", returns the index of the first word which has a
+ * zero byte, or the last whole word before "buf_size" */
+Eembed_no_sanitize_address
+static size_t eembed_word_find_zero(const char *str, size_t i, size_t buf_size)
+{
+	while ((buf_size - i) >= eembed_word_len) {
+		if (eembed_word_has_zero(*((const eembed_word_t *)(str + i)))) {
+			break;
+		}
+		i += eembed_word_len;
+	}
+	return i;
+}
+
+/* Whole words are only read once aligned, and an aligned word can not cross
+ * a page boundary, thus the word reads never fault beyond the string. */
 size_t eembed_diy_strnlen(const char *str, size_t buf_size)
 {
-	size_t i;
+	size_t i = 0;
 
-	for (i = 0; i < buf_size; ++i) {
+	while (i < buf_size && eembed_word_offset(str + i)) {
+		if (str[i] == '\0') {
+			return i;
+		}
+		++i;
+	}
+	i = eembed_word_find_zero(str, i, buf_size);
+	for (; i < buf_size; ++i) {
 		if (str[i] == '\0') {
 			return i;
 		}
@@ -955,13 +3147,160 @@ size_t eembed_diy_strlen(const char *s)
 	return eembed_strnlen(s, EEMBED_SSIZE_MAX);
 }
 
-char *eembed_diy_strstr(const char *haystack, const char *needle)
+/* Two-Way string matching, Crochemore and Perrin, 1991: linear time and
+ * constant space. The needle is split at a critical factorization into a
+ * left and a right part; the right part is compared left to right, then the
+ * left part right to left, and on a mismatch the window shifts by either
+ * the distance matched so far, or by the period of the needle. */
+
+/* finds the maximal suffix of the needle, using either the order of the
+ * bytes, or the reverse order; returns its start and sets its period */
+static size_t eembed_two_way_max_suffix(const unsigned char *needle,
+					size_t nlen, int reverse,
+					size_t *period)
 {
-	size_t i = 0;
+	size_t max_suffix = (size_t)-1;
 	size_t j = 0;
-	size_t found = 0;
+	size_t k = 1;
+	size_t p = 1;
+	unsigned char a, b;
+
+	while (j + k < nlen) {
+		a = needle[j + k];
+		b = needle[max_suffix + k];
+		if (reverse ? (a > b) : (a < b)) {
+			j += k;
+			k = 1;
+			p = j - max_suffix;
+		} else if (a == b) {
+			if (k != p) {
+				++k;
+			} else {
+				j += p;
+				k = 1;
+			}
+		} else {
+			max_suffix = j++;
+			k = p = 1;
+		}
+	}
+	*period = p;
+	return max_suffix + 1;
+}
+
+static size_t eembed_two_way_factorize(const unsigned char *needle,
+				       size_t nlen, size_t *period)
+{
+	size_t suffix, suffix_rev, period_rev;
+
+	suffix = eembed_two_way_max_suffix(needle, nlen, 0, period);
+	suffix_rev = eembed_two_way_max_suffix(needle, nlen, 1, &period_rev);
+	if (suffix_rev > suffix) {
+		*period = period_rev;
+		return suffix_rev;
+	}
+	return suffix;
+}
+
+/* For a NULL terminated haystack, the known length is only extended as the
+ * search window moves, thus the haystack is not measured up front, and the
+ * scan stops at the NULL. Extending by at least a minimum amount avoids
+ * measuring a few bytes at a time. */
+static int eembed_two_way_available(const unsigned char *haystack,
+				    size_t *hlen, size_t needed, int is_str)
+{
+	const size_t min_extend = 256;
+	size_t extend;
+
+	if (needed <= *hlen) {
+		return 1;
+	}
+	if (!is_str) {
+		return 0;
+	}
+	extend = needed - *hlen;
+	extend = (extend < min_extend) ? min_extend : extend;
+	*hlen += eembed_strnlen((const char *)haystack + *hlen, extend);
+	return needed <= *hlen;
+}
+
+static const unsigned char *eembed_two_way(const unsigned char *haystack,
+					   size_t hlen,
+					   const unsigned char *needle,
+					   size_t nlen, int is_str)
+{
+	size_t suffix, period, memory, i, j;
+
+	suffix = eembed_two_way_factorize(needle, nlen, &period);
+	j = 0;
+	if (eembed_memcmp(needle, needle + period, suffix) == 0) {
+		/* periodic needle: after a match of the right part, the
+		 * bytes of the next period already matched are remembered */
+		memory = 0;
+		while (eembed_two_way_available(haystack, &hlen, j + nlen,
+						is_str)) {
+			i = (suffix > memory) ? suffix : memory;
+			while (i < nlen && needle[i] == haystack[i + j]) {
+				++i;
+			}
+			if (i < nlen) {
+				j += i - suffix + 1;
+				memory = 0;
+				continue;
+			}
+			i = suffix;
+			while (i > memory
+			       && needle[i - 1] == haystack[(i - 1) + j]) {
+				--i;
+			}
+			if (i <= memory) {
+				return haystack + j;
+			}
+			j += period;
+			memory = nlen - period;
+		}
+		return NULL;
+	}
+
+	period = ((suffix > (nlen - suffix)) ? suffix : (nlen - suffix)) + 1;
+	while (eembed_two_way_available(haystack, &hlen, j + nlen, is_str)) {
+		i = suffix;
+		while (i < nlen && needle[i] == haystack[i + j]) {
+			++i;
+		}
+		if (i < nlen) {
+			j += i - suffix + 1;
+			continue;
+		}
+		i = suffix;
+		while (i > 0 && needle[i - 1] == haystack[(i - 1) + j]) {
+			--i;
+		}
+		if (i == 0) {
+			return haystack + j;
+		}
+		j += period;
+	}
+	return NULL;
+}
+
+void *eembed_diy_memmem(const void *haystack, size_t hlen,
+			const void *needle, size_t nlen)
+{
+	const unsigned char *found;
+
+	if (!nlen) {
+		return eembed_ignore_const_s((const char *)haystack);
+	}
+	found = eembed_two_way((const unsigned char *)haystack, hlen,
+			       (const unsigned char *)needle, nlen, 0);
+	return eembed_ignore_const_s((const char *)found);
+}
+
+char *eembed_diy_strstr(const char *haystack, const char *needle)
+{
+	const unsigned char *found;
 	size_t nlen = 0;
-	size_t hlen = 0;
 
 	/* glibc crashes on NULL */
 	eembed_assert(haystack);
@@ -971,23 +3310,328 @@ char *eembed_diy_strstr(const char *haystack, const char *needle)
 	if (!nlen) {
 		return eembed_ignore_const_s(haystack);
 	}
-	hlen = eembed_strlen(haystack);
-	if (nlen > hlen) {
-		return NULL;
+	found = eembed_two_way((const unsigned char *)haystack, 0,
+			       (const unsigned char *)needle, nlen, 1);
+	return eembed_ignore_const_s((const char *)found);
+}
+
+#if Eembed_use_diy_simd
+/* The SSE2 kernels handle 16 bytes at a time, the AVX2 kernels 32; shorter
+ * lengths are passed down to the next smaller kernel. The unaligned loads
+ * of memcmp, memcpy and memset stay within the requested lengths by ending
+ * with a vector which overlaps the previous one. The strlen loads are
+ * aligned, and thus never cross into a page the string does not occupy. */
+static int eembed_sse2_memcmp(const void *s1, const void *s2, size_t n)
+{
+	const unsigned char *a = (const unsigned char *)s1;
+	const unsigned char *b = (const unsigned char *)s2;
+	__m128i va, vb;
+	unsigned mask;
+	size_t i;
+
+	if (n < 16) {
+		return eembed_diy_memcmp(s1, s2, n);
 	}
-	for (i = 0; i < (hlen - (nlen - 1)); ++i) {
-		found = 1;
-		for (j = 0; found && j < nlen; ++j) {
-			if (haystack[i + j] != needle[j]) {
-				found = 0;
-			}
+	for (i = 0; i < n; i += 16) {
+		if ((n - i) < 16) {
+			i = n - 16;
 		}
-		if (found) {
-			return eembed_ignore_const_s(haystack + i);
+		va = _mm_loadu_si128((const __m128i *)(a + i));
+		vb = _mm_loadu_si128((const __m128i *)(b + i));
+		va = _mm_cmpeq_epi8(va, vb);
+		mask = (unsigned)_mm_movemask_epi8(va);
+		if (mask != 0xFFFF) {
+			i += (size_t)__builtin_ctz(~mask);
+			return a[i] - b[i];
 		}
 	}
-	return NULL;
+	return 0;
+}
+
+__attribute__((target("avx2")))
+static int eembed_avx2_memcmp(const void *s1, const void *s2, size_t n)
+{
+	const unsigned char *a = (const unsigned char *)s1;
+	const unsigned char *b = (const unsigned char *)s2;
+	__m256i va, vb;
+	unsigned mask;
+	size_t i;
+
+	if (n < 32) {
+		return eembed_sse2_memcmp(s1, s2, n);
+	}
+	for (i = 0; i < n; i += 32) {
+		if ((n - i) < 32) {
+			i = n - 32;
+		}
+		va = _mm256_loadu_si256((const __m256i *)(a + i));
+		vb = _mm256_loadu_si256((const __m256i *)(b + i));
+		va = _mm256_cmpeq_epi8(va, vb);
+		mask = (unsigned)_mm256_movemask_epi8(va);
+		if (mask != 0xFFFFFFFF) {
+			i += (size_t)__builtin_ctz(~mask);
+			return a[i] - b[i];
+		}
+	}
+	return 0;
+}
+
+static void *eembed_sse2_memcpy(void *dest, const void *src, size_t n)
+{
+	unsigned char *d = (unsigned char *)dest;
+	const unsigned char *s = (const unsigned char *)src;
+	__m128i v;
+	size_t i;
+
+	if (n < 16) {
+		return eembed_diy_memcpy(dest, src, n);
+	}
+	for (i = 0; (i + 16) < n; i += 16) {
+		v = _mm_loadu_si128((const __m128i *)(s + i));
+		_mm_storeu_si128((__m128i *)(d + i), v);
+	}
+	v = _mm_loadu_si128((const __m128i *)(s + (n - 16)));
+	_mm_storeu_si128((__m128i *)(d + (n - 16)), v);
+	return dest;
+}
+
+__attribute__((target("avx2")))
+static void *eembed_avx2_memcpy(void *dest, const void *src, size_t n)
+{
+	unsigned char *d = (unsigned char *)dest;
+	const unsigned char *s = (const unsigned char *)src;
+	__m256i v;
+	size_t i;
+
+	if (n < 32) {
+		return eembed_sse2_memcpy(dest, src, n);
+	}
+	for (i = 0; (i + 32) < n; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *)(s + i));
+		_mm256_storeu_si256((__m256i *)(d + i), v);
+	}
+	v = _mm256_loadu_si256((const __m256i *)(s + (n - 32)));
+	_mm256_storeu_si256((__m256i *)(d + (n - 32)), v);
+	return dest;
+}
+
+static void *eembed_sse2_memset(void *dest, int val, size_t n)
+{
+	unsigned char *d = (unsigned char *)dest;
+	__m128i v;
+	size_t i;
+
+	if (n < 16) {
+		return eembed_diy_memset(dest, val, n);
+	}
+	v = _mm_set1_epi8((char)val);
+	for (i = 0; (i + 16) < n; i += 16) {
+		_mm_storeu_si128((__m128i *)(d + i), v);
+	}
+	_mm_storeu_si128((__m128i *)(d + (n - 16)), v);
+	return dest;
+}
+
+__attribute__((target("avx2")))
+static void *eembed_avx2_memset(void *dest, int val, size_t n)
+{
+	unsigned char *d = (unsigned char *)dest;
+	__m256i v;
+	size_t i;
+
+	if (n < 32) {
+		return eembed_sse2_memset(dest, val, n);
+	}
+	v = _mm256_set1_epi8((char)val);
+	for (i = 0; (i + 32) < n; i += 32) {
+		_mm256_storeu_si256((__m256i *)(d + i), v);
+	}
+	_mm256_storeu_si256((__m256i *)(d + (n - 32)), v);
+	return dest;
+}
+
+/* the first load is from the aligned address at or before the string, the
+ * mask bits for the bytes before the string are shifted out */
+Eembed_no_sanitize_address
+static size_t eembed_sse2_strlen(const char *str)
+{
+	size_t offset = ((size_t)str) & 15;
+	const char *p = str - offset;
+	__m128i v;
+	unsigned mask;
+
+	v = _mm_load_si128((const __m128i *)p);
+	v = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+	mask = ((unsigned)_mm_movemask_epi8(v)) >> offset;
+	while (!mask) {
+		p += 16;
+		v = _mm_load_si128((const __m128i *)p);
+		v = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+		mask = (unsigned)_mm_movemask_epi8(v);
+		offset = 0;
+	}
+	return (size_t)(p - str) + offset + (size_t)__builtin_ctz(mask);
+}
+
+__attribute__((target("avx2")))
+Eembed_no_sanitize_address
+static size_t eembed_avx2_strlen(const char *str)
+{
+	size_t offset = ((size_t)str) & 31;
+	const char *p = str - offset;
+	__m256i v;
+	unsigned mask;
+
+	v = _mm256_load_si256((const __m256i *)p);
+	v = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+	mask = ((unsigned)_mm256_movemask_epi8(v)) >> offset;
+	while (!mask) {
+		p += 32;
+		v = _mm256_load_si256((const __m256i *)p);
+		v = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+		mask = (unsigned)_mm256_movemask_epi8(v);
+		offset = 0;
+	}
+	return (size_t)(p - str) + offset + (size_t)__builtin_ctz(mask);
+}
+
+/* like strlen, but stops at either the NULL or the byte "c", and returns
+ * a pointer to the one found first */
+Eembed_no_sanitize_address
+static const char *eembed_sse2_strchrnul(const char *str, char c)
+{
+	size_t offset = ((size_t)str) & 15;
+	const char *p = str - offset;
+	__m128i v, vc;
+	unsigned mask;
+
+	vc = _mm_set1_epi8(c);
+	v = _mm_load_si128((const __m128i *)p);
+	v = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+			 _mm_cmpeq_epi8(v, vc));
+	mask = ((unsigned)_mm_movemask_epi8(v)) >> offset;
+	while (!mask) {
+		p += 16;
+		v = _mm_load_si128((const __m128i *)p);
+		v = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+				 _mm_cmpeq_epi8(v, vc));
+		mask = (unsigned)_mm_movemask_epi8(v);
+		offset = 0;
+	}
+	return p + offset + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2")))
+Eembed_no_sanitize_address
+static const char *eembed_avx2_strchrnul(const char *str, char c)
+{
+	size_t offset = ((size_t)str) & 31;
+	const char *p = str - offset;
+	__m256i v, vc;
+	unsigned mask;
+
+	vc = _mm256_set1_epi8(c);
+	v = _mm256_load_si256((const __m256i *)p);
+	v = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()),
+			    _mm256_cmpeq_epi8(v, vc));
+	mask = ((unsigned)_mm256_movemask_epi8(v)) >> offset;
+	while (!mask) {
+		p += 32;
+		v = _mm256_load_si256((const __m256i *)p);
+		v = _mm256_or_si256(_mm256_cmpeq_epi8(v,
+						      _mm256_setzero_si256()),
+				    _mm256_cmpeq_epi8(v, vc));
+		mask = (unsigned)_mm256_movemask_epi8(v);
+		offset = 0;
+	}
+	return p + offset + __builtin_ctz(mask);
+}
+
+/* The vectors only skip ahead to the first byte of the haystack which
+ * matches the first byte of the needle; from there a single Two-Way search
+ * runs, thus the search stays linear, and the haystack is not measured. */
+static char *eembed_sse2_strstr(const char *haystack, const char *needle)
+{
+	eembed_assert(haystack);
+	eembed_assert(needle);
+
+	if (needle[0] != '\0') {
+		haystack = eembed_sse2_strchrnul(haystack, needle[0]);
+		if (*haystack == '\0') {
+			return NULL;
+		}
+	}
+	return eembed_diy_strstr(haystack, needle);
+}
+
+__attribute__((target("avx2")))
+static char *eembed_avx2_strstr(const char *haystack, const char *needle)
+{
+	eembed_assert(haystack);
+	eembed_assert(needle);
+
+	if (needle[0] != '\0') {
+		haystack = eembed_avx2_strchrnul(haystack, needle[0]);
+		if (*haystack == '\0') {
+			return NULL;
+		}
+	}
+	return eembed_diy_strstr(haystack, needle);
+}
+
+/* SSE2 is part of x86-64, thus it is the level until the CPU is checked */
+int (*eembed_simd_memcmp)(const void *s1, const void *s2, size_t n) =
+    eembed_sse2_memcmp;
+void *(*eembed_simd_memcpy)(void *dest, const void *src, size_t n) =
+    eembed_sse2_memcpy;
+void *(*eembed_simd_memset)(void *dest, int val, size_t n) =
+    eembed_sse2_memset;
+size_t (*eembed_simd_strlen)(const char *s) = eembed_sse2_strlen;
+char *(*eembed_simd_strstr)(const char *haystack, const char *needle) =
+    eembed_sse2_strstr;
+
+enum eembed_simd_level eembed_simd_select(enum eembed_simd_level max_level)
+{
+	enum eembed_simd_level level = eembed_simd_sse2;
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		level = eembed_simd_avx2;
+	}
+	level = (max_level < level) ? max_level : level;
+
+	switch (level) {
+	case eembed_simd_avx2:
+		eembed_simd_memcmp = eembed_avx2_memcmp;
+		eembed_simd_memcpy = eembed_avx2_memcpy;
+		eembed_simd_memset = eembed_avx2_memset;
+		eembed_simd_strlen = eembed_avx2_strlen;
+		eembed_simd_strstr = eembed_avx2_strstr;
+		break;
+	case eembed_simd_sse2:
+		eembed_simd_memcmp = eembed_sse2_memcmp;
+		eembed_simd_memcpy = eembed_sse2_memcpy;
+		eembed_simd_memset = eembed_sse2_memset;
+		eembed_simd_strlen = eembed_sse2_strlen;
+		eembed_simd_strstr = eembed_sse2_strstr;
+		break;
+	default:
+		eembed_simd_memcmp = eembed_diy_memcmp;
+		eembed_simd_memcpy = eembed_diy_memcpy;
+		eembed_simd_memset = eembed_diy_memset;
+		eembed_simd_strlen = eembed_diy_strlen;
+		eembed_simd_strstr = eembed_diy_strstr;
+		break;
+	}
+	return level;
+}
+
+__attribute__((constructor))
+static void eembed_simd_select_at_startup(void)
+{
+	eembed_simd_select(eembed_simd_avx2);
 }
+#endif /* Eembed_use_diy_simd */
 
 static uint32_t eembed_min_u32(uint32_t a, uint32_t b)
 {
@@ -1356,21 +4000,25 @@ void eembed_bytes_allocator_dump(struct eembed_log *log,
 	}
 }
 
-static size_t eembed_bytes_allocator_visual_inner(struct eembed_log *log,
-						  size_t pos, const char *str,
-						  char fill,
-						  size_t size, size_t width)
+/* appends "bytes" if not NULL, otherwise "c", wrapping at "width" */
+static size_t eembed_bytes_allocator_visual_run(struct eembed_log *log,
+						size_t pos, const char *bytes,
+						char c, size_t len,
+						size_t width)
 {
-	size_t i;
-	int str_end_found = !str;
-	for (i = 0; i < size; ++i) {
-		char c = (str_end_found) ? fill : str[i];
-		if (!c) {
-			c = '0';
-			str_end_found = 1;
-		}
-		log->append_c(log, c);
-		++pos;
+	size_t n = 0;
+
+	while (len) {
+		n = width - (pos % width);
+		n = (n < len) ? n : len;
+		if (bytes) {
+			eembed_log_append_n(log, bytes, n);
+			bytes += n;
+		} else {
+			eembed_log_append_fill(log, c, n);
+		}
+		pos += n;
+		len -= n;
 		if ((pos % width) == 0) {
 			log->append_eol(log);
 		}
@@ -1378,6 +4026,25 @@ static size_t eembed_bytes_allocator_visual_inner(struct eembed_log *log,
 	return pos;
 }
 
+static size_t eembed_bytes_allocator_visual_inner(struct eembed_log *log,
+						  size_t pos, const char *str,
+						  char fill,
+						  size_t size, size_t width)
+{
+	size_t len = str ? eembed_strnlen(str, size) : 0;
+
+	pos = eembed_bytes_allocator_visual_run(log, pos, str, '\0', len,
+						width);
+	/* the end of the string is shown as a '0' */
+	if (len < size && str) {
+		pos = eembed_bytes_allocator_visual_run(log, pos, NULL, '0', 1,
+							width);
+		++len;
+	}
+	return eembed_bytes_allocator_visual_run(log, pos, NULL, fill,
+						 size - len, width);
+}
+
 void eembed_bytes_allocator_visual(struct eembed_log *log,
 				   struct eembed_allocator *bytes_allocator,
 				   int strinify_contents, size_t width)
@@ -1520,22 +4187,47 @@ struct eembed_allocator *eembed_global_allocator = &eembed_null_chunk_allocator;
 
 #if (FAUX_FREESTANDING)
 int printf(const char *format, ...);
-void eembed_faux_freestanding_append_s(struct eembed_log *log, const char *str)
+void eembed_faux_freestanding_write(void *sink, const char *bytes, size_t len)
 {
-	(void)log;
-	printf("%s", str);
+	size_t n = 0;
+
+	(void)sink;
+	while (len) {
+		n = (len < INT_MAX) ? len : INT_MAX;
+		printf("%.*s", (int)n, bytes);
+		bytes += n;
+		len -= n;
+	}
 }
 
-struct eembed_log eembed_faux_freestanding_log = {
+static char eembed_faux_freestanding_line[Eembed_faux_freestanding_line_size];
+
+static struct eembed_buffered_log eembed_faux_freestanding_buffered = {
+	eembed_faux_freestanding_line,
+	Eembed_faux_freestanding_line_size,
+	0,
+	eembed_faux_freestanding_write,
 	NULL,
-	eembed_log_str_append_c,
-	eembed_faux_freestanding_append_s,
+	1,
+	{
+	 eembed_buffered_log_flush_hook,
+	 &eembed_faux_freestanding_buffered,
+	 NULL,
+	 },
+};
+
+struct eembed_log eembed_faux_freestanding_log = {
+	&eembed_faux_freestanding_buffered,
+	eembed_buffered_log_append_c,
+	eembed_buffered_log_append_s,
 	eembed_log_str_append_ul,
 	eembed_log_str_append_l,
 	eembed_log_str_append_f,
 	eembed_log_str_append_fd,
 	eembed_log_str_append_vp,
-	eembed_log_str_append_eol,
+	eembed_buffered_log_append_eol,
+	eembed_buffered_log_append_n,
+	eembed_log_str_append_fill,
 };
 
 void eembed_system_print_init(void)
@@ -1543,6 +4235,9 @@ void eembed_system_print_init(void)
 	if (FAUX_FREESTANDING) {
 		eembed_out_log = &eembed_faux_freestanding_log;
 		eembed_err_log = &eembed_faux_freestanding_log;
+		/* a partial line is written before a crash */
+		eembed_flush_hook_add(&eembed_faux_freestanding_buffered.
+				      flush_hook);
 	}
 }
 #else
@@ -1598,17 +4293,54 @@ void eembed_hosted_delay_ms_u16(uint16_t milliseconds)
 #endif
 }
 
-uint64_t eembed_hosted_uptime_ms(void)
-{
 #if (_POSIX_C_SOURCE >= 199309L)
+static uint64_t eembed_hosted_clock_ns(clockid_t clock_id)
+{
 	struct timespec ts;
 
-	return (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
-	    ? 0 : (ts.tv_sec * 1000 + ts.tv_nsec / 1e6);
+	/* integer math, no floating point division */
+	return (clock_gettime(clock_id, &ts) != 0)
+	    ? 0 : (((uint64_t)ts.tv_sec) * 1000 * 1000 * 1000) + ts.tv_nsec;
+}
+
+uint64_t eembed_hosted_uptime_ns(void)
+{
+	return eembed_hosted_clock_ns(CLOCK_MONOTONIC);
+}
+
+uint64_t eembed_hosted_uptime_ns_coarse(void)
+{
+#ifdef CLOCK_MONOTONIC_COARSE
+	return eembed_hosted_clock_ns(CLOCK_MONOTONIC_COARSE);
+#else
+	return eembed_hosted_clock_ns(CLOCK_MONOTONIC);
+#endif
+}
 #else
+/* clock() counts processor time in CLOCKS_PER_SEC units, thus the whole
+ * seconds and the remainder are scaled separately, to avoid overflow */
+uint64_t eembed_hosted_uptime_ns(void)
+{
+	const uint64_t ns_per_s = 1000UL * 1000UL * 1000UL;
+	const uint64_t per_s = (uint64_t)CLOCKS_PER_SEC;
 	clock_t now = clock();
-	/* the units of clock_t are hard to map to milliseconds */
-	return now * 1000;
+	uint64_t c;
+
+	if (now == (clock_t)-1) {
+		return 0;
+	}
+	c = (uint64_t)now;
+	return ((c / per_s) * ns_per_s) + (((c % per_s) * ns_per_s) / per_s);
+}
+
+uint64_t eembed_hosted_uptime_ns_coarse(void)
+{
+	return eembed_hosted_uptime_ns();
+}
 #endif
+
+uint64_t eembed_hosted_uptime_ms(void)
+{
+	return eembed_hosted_uptime_ns() / (1000 * 1000);
 }
 #endif
@@ -74,6 +74,16 @@ Eembed_begin_C_declarations;
 #ifndef FAUX_FREESTANDING
 #define FAUX_FREESTANDING 0
 #endif
+
+/* per-thread storage for the few globals which describe the call in
+ * progress; where threads are not available, a plain global suffices */
+#ifndef EEMBED_THREAD_LOCAL
+#if ((EEMBED_HOSTED || FAUX_FREESTANDING) && defined(__GNUC__))
+#define EEMBED_THREAD_LOCAL __thread
+#else
+#define EEMBED_THREAD_LOCAL
+#endif
+#endif
 /***************************************************************************\
  * The headers required by freestanding environments, are mostly those that
  * define macros and types.
@@ -508,6 +518,22 @@ char *eembed_bytes_to_hex(char *buf, size_t buf_size, unsigned char *bytes,
 #if (EEMBED_HOSTED && (!(FAUX_FREESTANDING)))
 #include <string.h>
 
+#ifndef eembed_memchr
+#define eembed_memchr memchr
+#endif
+
+#ifndef eembed_memrchr
+#if defined(_GNU_SOURCE)
+#define eembed_memrchr memrchr
+#endif
+#endif
+
+#ifndef eembed_memmem
+#if defined(_GNU_SOURCE)
+#define eembed_memmem memmem
+#endif
+#endif
+
 #ifndef eembed_memcmp
 #define eembed_memcmp memcmp
 #endif
@@ -548,6 +574,12 @@ char *eembed_bytes_to_hex(char *buf, size_t buf_size, unsigned char *bytes,
 #define eembed_strncpy strncpy
 #endif
 
+#ifndef eembed_stpcpy
+#if (_POSIX_C_SOURCE >= 200809L)
+#define eembed_stpcpy stpcpy
+#endif
+#endif
+
 #ifndef eembed_strlen
 #define eembed_strlen strlen
 #endif
@@ -568,6 +600,9 @@ char *eembed_bytes_to_hex(char *buf, size_t buf_size, unsigned char *bytes,
  * returns 0 on success or non-zero if the value was truncated. */
 int eembed_strcpy_safe(char *buf, size_t size, const char *str);
 
+void *eembed_diy_memchr(const void *s, int c, size_t n);
+void *eembed_diy_memrchr(const void *s, int c, size_t n);
+
 int eembed_diy_memcmp(const void *s1, const void *s2, size_t n);
 
 void *eembed_diy_memcpy(void *dest, const void *src, size_t n);
@@ -584,14 +619,81 @@ int eembed_diy_strncmp(const char *s1, const char *s2, size_t n);
 char *eembed_diy_strcpy(char *dest, const char *src);
 char *eembed_diy_strncpy(char *dest, const char *src, size_t n);
 
+/* stpcpy() returns a pointer to the terminating NULL of dest */
+char *eembed_diy_stpcpy(char *dest, const char *src);
+
+/* strlcpy() always terminates (if size > 0) and returns strlen(src) */
+size_t eembed_diy_strlcpy(char *dest, const char *src, size_t size);
+
 size_t eembed_diy_strlen(const char *s);
 size_t eembed_diy_strnlen(const char *s, size_t maxlen);
 
 char *eembed_diy_strstr(const char *haystack, const char *needle);
 
+void *eembed_diy_memmem(const void *haystack, size_t haystack_len,
+			const void *needle, size_t needle_len);
+
 int64_t eembed_diy_str_to_i64(const char *str, char **endptr, int base);
 uint64_t eembed_diy_str_to_u64(const char *str, char **endptr, int pbase);
 
+/* In FAUX_FREESTANDING simulation builds on x86-64, the eembed_ mem/str
+ * functions may call SSE2 or AVX2 versions of the diy functions, selected
+ * once at startup by what the CPU supports. The eembed_simd_ function
+ * pointers are set by eembed_simd_select(), which chooses the best level
+ * which is available and not above the max_level, and returns it; tests may
+ * call it to exercise each level, including the portable versions. */
+#ifndef Eembed_use_diy_simd
+#if (FAUX_FREESTANDING && defined(__x86_64__) && defined(__GNUC__))
+#define Eembed_use_diy_simd 1
+#else
+#define Eembed_use_diy_simd 0
+#endif
+#endif
+
+#if Eembed_use_diy_simd
+enum eembed_simd_level {
+	eembed_simd_portable = 0,
+	eembed_simd_sse2 = 1,
+	eembed_simd_avx2 = 2
+};
+
+enum eembed_simd_level eembed_simd_select(enum eembed_simd_level max_level);
+
+extern int (*eembed_simd_memcmp)(const void *s1, const void *s2, size_t n);
+extern void *(*eembed_simd_memcpy)(void *dest, const void *src, size_t n);
+extern void *(*eembed_simd_memset)(void *dest, int val, size_t n);
+extern size_t (*eembed_simd_strlen)(const char *s);
+extern char *(*eembed_simd_strstr)(const char *haystack, const char *needle);
+
+#ifndef eembed_memcmp
+#define eembed_memcmp eembed_simd_memcmp
+#endif
+
+#ifndef eembed_memcpy
+#define eembed_memcpy eembed_simd_memcpy
+#endif
+
+#ifndef eembed_memset
+#define eembed_memset eembed_simd_memset
+#endif
+
+#ifndef eembed_strlen
+#define eembed_strlen eembed_simd_strlen
+#endif
+
+#ifndef eembed_strstr
+#define eembed_strstr eembed_simd_strstr
+#endif
+#endif /* Eembed_use_diy_simd */
+
+#ifndef eembed_memchr
+#define eembed_memchr eembed_diy_memchr
+#endif
+
+#ifndef eembed_memrchr
+#define eembed_memrchr eembed_diy_memrchr
+#endif
+
 #ifndef eembed_memcmp
 #define eembed_memcmp eembed_diy_memcmp
 #endif
@@ -632,6 +734,14 @@ uint64_t eembed_diy_str_to_u64(const char *str, char **endptr, int pbase);
 #define eembed_strncpy eembed_diy_strncpy
 #endif
 
+#ifndef eembed_stpcpy
+#define eembed_stpcpy eembed_diy_stpcpy
+#endif
+
+#ifndef eembed_strlcpy
+#define eembed_strlcpy eembed_diy_strlcpy
+#endif
+
 #ifndef eembed_strlen
 #define eembed_strlen eembed_diy_strlen
 #endif
@@ -644,6 +754,10 @@ uint64_t eembed_diy_str_to_u64(const char *str, char **endptr, int pbase);
 #define eembed_strstr eembed_diy_strstr
 #endif
 
+#ifndef eembed_memmem
+#define eembed_memmem eembed_diy_memmem
+#endif
+
 /***************************************************************************\
  * Even on __STDC_HOSTED__ systems, there is not a uniform way to get
  * randomness. Linux has getrandom(2), POSIX has /dev/random, etc.
@@ -687,6 +801,11 @@ void eembed_hosted_delay_ms_u16(uint16_t milliseconds);
 uint64_t eembed_hosted_uptime_ms(void);
 #define uptime_ms() eembed_hosted_uptime_ms()
 #endif
+
+/* a monotonic clock in nanoseconds; the "coarse" clock is much cheaper to
+ * read, but only advances every few milliseconds (where available) */
+uint64_t eembed_hosted_uptime_ns(void);
+uint64_t eembed_hosted_uptime_ns_coarse(void);
 #endif /* (EEMBED_HOSTED || FAUX_FREESTANDING) */
 
 /***************************************************************************\
@@ -703,6 +822,35 @@ void *eembed_realloc(void *ptr, size_t size);
 void *eembed_reallocarray(void *ptr, size_t nmemb, size_t size);
 void eembed_free(void *ptr);
 
+/* The site of the allocation in progress, for allocators which report on
+ * their callers, e.g.: echeck_no_alloc. The eembed_malloc_at() family of
+ * macros record the __FILE__ and __LINE__ of the call, which is cleared as
+ * the allocation returns. With GCC, the allocation functions also record
+ * their return address as the "caller", which addr2line can resolve. */
+struct eembed_alloc_site {
+	const char *file;
+	int line;
+	const void *caller;
+};
+extern EEMBED_THREAD_LOCAL struct eembed_alloc_site eembed_alloc_site;
+
+#define eembed_alloc_site_set(site_file, site_line) \
+	(eembed_alloc_site.file = (site_file), \
+	 eembed_alloc_site.line = (site_line))
+
+#define eembed_malloc_at(size) \
+	(eembed_alloc_site_set(__FILE__, __LINE__), eembed_malloc(size))
+
+#define eembed_calloc_at(nmemb, size) \
+	(eembed_alloc_site_set(__FILE__, __LINE__), eembed_calloc(nmemb, size))
+
+#define eembed_realloc_at(ptr, size) \
+	(eembed_alloc_site_set(__FILE__, __LINE__), eembed_realloc(ptr, size))
+
+#define eembed_reallocarray_at(ptr, nmemb, size) \
+	(eembed_alloc_site_set(__FILE__, __LINE__), \
+	 eembed_reallocarray(ptr, nmemb, size))
+
 struct eembed_allocator;
 
 /* eembed_global_allocator may be the null_allocator, if not EEMBED_HOSTED */
@@ -758,17 +906,459 @@ struct eembed_log {
 	void (*append_fd)(struct eembed_log *log, long double f, uint8_t d);
 	void (*append_vp)(struct eembed_log *log, const void *ptr);
 	void (*append_eol)(struct eembed_log *log);
+	/* the members below were added last, so that a log which was written
+	 * before they existed keeps its layout; as such a log leaves them
+	 * NULL, call them through eembed_log_append_n and _append_fill */
+	/* appends "len" bytes, which need not be NUL terminated */
+	void (*append_n)(struct eembed_log *log, const char *bytes, size_t len);
+	/* appends "c" "count" times */
+	void (*append_fill)(struct eembed_log *log, char c, size_t count);
 };
 
+/* calls log->append_n or log->append_fill, or if NULL, the generic version */
+void eembed_log_append_n(struct eembed_log *log, const char *bytes,
+			 size_t len);
+void eembed_log_append_fill(struct eembed_log *log, char c, size_t count);
+
+/* generic implementations for logs which have no better way:
+ * append_n passes the bytes to log->append_s in small chunks,
+ * append_fill passes small chunks of "c" to eembed_log_append_n */
+void eembed_log_str_append_n(struct eembed_log *log, const char *bytes,
+			     size_t len);
+void eembed_log_str_append_fill(struct eembed_log *log, char c, size_t count);
+
+/* "used" caches the length of the string in "buf", thus an append costs
+ * only the length of the appended string; a buffer which is written to
+ * directly should be cleared or eembed_str_buf_reset before appending */
 struct eembed_str_buf {
 	char *buf;
 	size_t size;
+	size_t used;
 };
 
 struct eembed_log *eembed_char_buf_log_init(struct eembed_log *log,
 					    struct eembed_str_buf *ctx,
 					    char *buf, size_t size);
 
+/* the length of the string in the buffer */
+size_t eembed_str_buf_len(struct eembed_str_buf *ctx);
+
+/* empties the buffer, so that the next append starts at the beginning */
+void eembed_str_buf_reset(struct eembed_str_buf *ctx);
+
+/***************************************************************************\
+ * Flush hooks are run just before an eembed_assert crash and, in hosted
+ * environments, at exit. Anything which holds output in a buffer may add a
+ * hook so that the output is not lost. Hooks are not synchronized; add and
+ * remove them before starting threads. A hook must be removed before its
+ * memory goes out of scope.
+\***************************************************************************/
+struct eembed_flush_hook {
+	void (*flush)(void *context);
+	void *context;
+	struct eembed_flush_hook *next;
+};
+
+void eembed_flush_hook_add(struct eembed_flush_hook *hook);
+void eembed_flush_hook_remove(struct eembed_flush_hook *hook);
+void eembed_flush_hooks_run(void);
+
+/***************************************************************************\
+ * A buffered log collects the appended text in a caller-provided buffer, and
+ * passes it to the "write" function only when the buffer is full, or at
+ * eembed_buffered_log_flush, or at each append_eol if "flush_on_eol" is set.
+ * To also flush at crash or exit, eembed_flush_hook_add(&ctx->flush_hook).
+\***************************************************************************/
+struct eembed_buffered_log {
+	char *buf;
+	size_t size;
+	size_t used;
+	void (*write)(void *sink, const char *bytes, size_t len);
+	void *sink;
+	unsigned char flush_on_eol;
+	struct eembed_flush_hook flush_hook;
+};
+
+struct eembed_log *eembed_buffered_log_init(struct eembed_log *log,
+					    struct eembed_buffered_log *ctx,
+					    char *buf, size_t size,
+					    void (*write)(void *sink,
+							  const char *bytes,
+							  size_t len),
+					    void *sink);
+
+void eembed_buffered_log_flush(struct eembed_buffered_log *ctx);
+
+/***************************************************************************\
+ * A binary log defers the formatting: each append is recorded as a tag byte
+ * followed by the raw value, and the records are later rendered to text by
+ * eembed_binary_log_decode, typically on a host. Integers are LEB128 varints
+ * (signed values zig-zag encoded), strings are a varint length and the
+ * bytes, or the varint index of the string in the "strings" table, if the
+ * appended pointer is found there. Floats are the raw bytes of a double in
+ * the byte order of the logging system, preceded by their size.
+\***************************************************************************/
+#define eembed_binary_log_tag_c 'c'	/* char */
+#define eembed_binary_log_tag_s 's'	/* varint len, bytes */
+#define eembed_binary_log_tag_id 'S'	/* varint index into strings */
+#define eembed_binary_log_tag_ul 'u'	/* varint */
+#define eembed_binary_log_tag_l 'l'	/* zig-zag varint */
+#define eembed_binary_log_tag_f 'f'	/* size, bytes */
+#define eembed_binary_log_tag_fd 'd'	/* digits, size, bytes */
+#define eembed_binary_log_tag_vp 'p'	/* varint */
+#define eembed_binary_log_tag_eol 'n'
+
+struct eembed_binary_log {
+	struct eembed_buffered_log out;
+	const char **strings;
+	size_t strings_len;
+};
+
+struct eembed_log *eembed_binary_log_init(struct eembed_log *log,
+					  struct eembed_binary_log *ctx,
+					  char *buf, size_t size,
+					  void (*write)(void *sink,
+							const char *bytes,
+							size_t len),
+					  void *sink, const char **strings,
+					  size_t strings_len);
+
+/* renders the records to the log, returns the number of bytes decoded,
+ * which is less than "len" if the last record is incomplete or unknown */
+size_t eembed_binary_log_decode(struct eembed_log *log,
+				const unsigned char *bytes, size_t len,
+				const char **strings, size_t strings_len);
+
+/***************************************************************************\
+ * A circular log keeps the last bytes of the log output in a caller-supplied
+ * buffer, overwriting the oldest. The position is kept in a header at the
+ * start of the buffer, thus if the buffer survives a restart (e.g.: it is in
+ * no-init RAM, or is an mmap'd file), eembed_circular_log_dump can replay
+ * the output from before the restart. The buffer must be aligned for a
+ * uint32_t and larger than the header; re-initializing a buffer which holds
+ * a valid header of the same size keeps the contents.
+\***************************************************************************/
+struct eembed_circular_log_header {
+	uint32_t magic;
+	uint32_t size;
+	uint32_t next;
+	uint32_t wrapped;
+};
+
+struct eembed_log *eembed_circular_log_init(struct eembed_log *log,
+					    unsigned char *bytes, size_t len);
+
+/* forgets the contents */
+void eembed_circular_log_clear(unsigned char *bytes, size_t len);
+
+/* writes the retained output, oldest first, returns the number of bytes */
+size_t eembed_circular_log_dump(struct eembed_log *out,
+				const unsigned char *bytes, size_t len);
+
+/***************************************************************************\
+ * A tee log forwards to several sinks. Strings are measured once and the
+ * numbers are formatted once, then the bytes are given to the append_n of
+ * each sink. Each sink has a maximum level: a message logged with the
+ * leveled macros (eembed_info, eembed_debug, etc.) above that level is not
+ * given to that sink, other messages are given to every sink. The
+ * eembed_log_level must be at least the highest of the sink levels.
+\***************************************************************************/
+struct eembed_tee_log_sink {
+	struct eembed_log *log;
+	unsigned char level;
+};
+
+struct eembed_tee_log {
+	struct eembed_tee_log_sink *sinks;
+	size_t sinks_len;
+};
+
+struct eembed_log *eembed_tee_log_init(struct eembed_log *log,
+				       struct eembed_tee_log *ctx,
+				       struct eembed_tee_log_sink *sinks,
+				       size_t sinks_len);
+
+/***************************************************************************\
+ * A dedup log wraps a sink, and suppresses repeated lines, e.g.: the same
+ * failure reported from within a loop. Each line is collected in "line",
+ * and is hashed; the numbers are not part of the hash, thus lines which
+ * differ only in the numbers (usually from the same call site) are
+ * "similar". The first "limit" similar lines of each "window_ns" are passed
+ * to the sink, after that every "summary_every"-th similar line is passed
+ * along with the count of lines suppressed. The window is timed by the
+ * "now_ns" clock; if "now_ns" is NULL, eembed_hosted_uptime_ns_coarse is
+ * used where available, otherwise there is no window, and the limit is for
+ * the life of the log. The "entries" track the recent lines, more entries
+ * means fewer collisions. eembed_dedup_log_flush reports the remaining
+ * suppressed counts and passes on a partial line, the "flush_hook" may be
+ * added with eembed_flush_hook_add to do so at exit.
+\***************************************************************************/
+struct eembed_dedup_log_entry {
+	uint32_t hash;
+	unsigned long count;
+	unsigned long suppressed;
+	uint64_t window_start;
+};
+
+struct eembed_dedup_log {
+	struct eembed_log *sink;
+	char *line;
+	size_t line_size;
+	size_t used;
+	uint32_t hash;
+	struct eembed_dedup_log_entry *entries;
+	size_t entries_len;
+	/* defaults to 3 */
+	unsigned long limit;
+	/* defaults to 100 */
+	unsigned long summary_every;
+	uint64_t (*now_ns)(void);
+	/* defaults to one second */
+	uint64_t window_ns;
+	struct eembed_flush_hook flush_hook;
+};
+
+struct eembed_log *eembed_dedup_log_init(struct eembed_log *log,
+					 struct eembed_dedup_log *ctx,
+					 char *line, size_t line_size,
+					 struct eembed_dedup_log_entry
+					 *entries, size_t entries_len,
+					 uint64_t (*now_ns)(void),
+					 struct eembed_log *sink);
+
+void eembed_dedup_log_flush(struct eembed_dedup_log *ctx);
+
+/***************************************************************************\
+ * A timestamp log wraps a sink, and prefixes each line with the time from
+ * the "now_ns" clock as seconds and nanoseconds, e.g.: "12.000345678 ".
+ * The clock is read once per line, at the first append of the line. If
+ * "now_ns" is NULL, eembed_hosted_uptime_ns is used where available.
+\***************************************************************************/
+struct eembed_timestamp_log {
+	struct eembed_log *sink;
+	uint64_t (*now_ns)(void);
+	unsigned char line_started;
+};
+
+struct eembed_log *eembed_timestamp_log_init(struct eembed_log *log,
+					     struct eembed_timestamp_log *ctx,
+					     uint64_t (*now_ns)(void),
+					     struct eembed_log *sink);
+
+/***************************************************************************\
+ * A serial log collects each line in a buffer and hands the whole line to
+ * the serial port with a single write, rather than one write per fragment.
+ * The port is described by a struct of function pointers, thus it may be
+ * an Arduino HardwareSerial (see eembed-arduino.cpp), a UART driver, or a
+ * stub in a test. If "non_blocking" is set, a line for which the port does
+ * not have room in its transmit buffer is dropped and counted, rather than
+ * waiting for the port. A line longer than the buffer is written in pieces;
+ * once a piece is dropped, the rest of the line is dropped with it, and the
+ * line is counted once. Thus the buffer should be no larger than the room
+ * in an empty transmit buffer.
+\***************************************************************************/
+struct eembed_serial {
+	void *context;
+	/* may block until all is written, returns the bytes written */
+	size_t (*write)(void *context, const char *bytes, size_t len);
+	/* the bytes which may be written without blocking */
+	size_t (*available_for_write)(void *context);
+};
+
+struct eembed_serial_log {
+	struct eembed_buffered_log out;
+	struct eembed_serial *serial;
+	unsigned char non_blocking;
+	unsigned long dropped;
+	/* set while the rest of a dropped line is being dropped */
+	unsigned char dropping;
+};
+
+struct eembed_log *eembed_serial_log_init(struct eembed_log *log,
+					  struct eembed_serial_log *ctx,
+					  char *buf, size_t size,
+					  struct eembed_serial *serial,
+					  unsigned char non_blocking);
+
+/***************************************************************************\
+ * A ring log lets many threads log without locks and without blocking on
+ * I/O: each thread collects a line in a thread-local buffer, and at the
+ * append_eol the whole line is placed in a slot of a bounded ring. A single
+ * consumer calls eembed_ring_log_drain to pass the lines to the "sink" log.
+ * If the ring is full the line is dropped and counted; a line longer than
+ * the slot is truncated and counted. A thread should finish a line before
+ * starting a line on another ring log. The number of slots is rounded down
+ * to a power of two.
+\***************************************************************************/
+#ifndef Eembed_use_ring_log
+#if (EEMBED_HOSTED && defined(__ATOMIC_SEQ_CST))
+#define Eembed_use_ring_log 1
+#else
+#define Eembed_use_ring_log 0
+#endif
+#endif
+
+#ifndef Eembed_ring_log_line_size
+#define Eembed_ring_log_line_size 160
+#endif
+
+#if Eembed_use_ring_log
+struct eembed_ring_log_slot {
+	size_t seq;
+	char line[Eembed_ring_log_line_size];
+};
+
+struct eembed_ring_log {
+	struct eembed_ring_log_slot *slots;
+	size_t mask;
+	size_t head;
+	size_t tail;
+	unsigned long dropped;
+	unsigned long truncated;
+	struct eembed_log *sink;
+	struct eembed_flush_hook flush_hook;
+	/* optional, called when the ring is full, return non-zero to retry */
+	int (*full)(struct eembed_ring_log *ring);
+	/* optional, called after each line is added to the ring */
+	void (*pushed)(struct eembed_ring_log *ring);
+	/* if set, each line is dropped (and counted) rather than added */
+	unsigned char closed;
+};
+
+struct eembed_log *eembed_ring_log_init(struct eembed_log *log,
+					struct eembed_ring_log *ring,
+					struct eembed_ring_log_slot *slots,
+					size_t slots_len,
+					struct eembed_log *sink);
+
+/* must only be called by one thread at a time, returns lines drained */
+size_t eembed_ring_log_drain(struct eembed_ring_log *ring);
+#endif
+
+/***************************************************************************\
+ * An async log is a ring log drained by a background writer thread, thus
+ * the I/O of the "sink" log is taken off of the logging threads. When the
+ * ring is full, a line is dropped and counted, or if "block_when_full" the
+ * logging thread waits for the writer. The writer sleeps while the ring is
+ * empty, and is woken by the next line. Starting adds a flush hook, thus the
+ * remaining lines are written and the writer joined at crash or exit.
+ * Lines logged after eembed_async_log_stop are dropped and counted; stop
+ * should not be called while other threads are still logging to the async
+ * log. If stop is called on the writer thread itself (e.g.: by the flush
+ * hook, as the sink crashes), the writer is detached rather than joined, and
+ * finishes the remaining lines on its own.
+\***************************************************************************/
+#ifndef Eembed_use_async_log
+#if (Eembed_use_ring_log && defined(__unix__))
+#define Eembed_use_async_log 1
+#else
+#define Eembed_use_async_log 0
+#endif
+#endif
+
+#if Eembed_use_async_log
+#include <pthread.h>
+
+struct eembed_async_log {
+	struct eembed_ring_log ring;
+	unsigned char block_when_full;
+	unsigned char running;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake_writer;
+	pthread_cond_t wake_producers;
+	pthread_t writer;
+	struct eembed_flush_hook flush_hook;
+	/* set while the writer sleeps, so that a line will wake it */
+	unsigned char writer_waiting;
+	/* the mutex and condition variables exist between start and stop */
+	unsigned char started;
+};
+
+/* returns NULL if the writer thread could not be started */
+struct eembed_log *eembed_async_log_start(struct eembed_log *log,
+					  struct eembed_async_log *ctx,
+					  struct eembed_ring_log_slot *slots,
+					  size_t slots_len,
+					  struct eembed_log *sink,
+					  unsigned char block_when_full);
+
+/* writes the remaining lines, and joins the writer thread */
+void eembed_async_log_stop(struct eembed_async_log *ctx);
+#endif
+
+#if EEMBED_HOSTED
+/* The eembed_stdout_context and eembed_stderr_context return the stream
+ * after coordinating stdout and stderr as POSIX requires; the stdio write
+ * expects one of these (or a similar eembed_function_context) as the sink:
+ *	eembed_buffered_log_init(&log, &ctx, buf, size, eembed_stdio_write,
+ *				 &eembed_stdout_context);
+ */
+extern struct eembed_function_context eembed_stdout_context;
+extern struct eembed_function_context eembed_stderr_context;
+void eembed_stdio_write(void *sink, const char *bytes, size_t len);
+#endif
+
+/* On unix-like hosted systems, a buffered log may also write directly to a
+ * file descriptor with write(2)/writev(2), bypassing stdio. The numbers are
+ * formatted with the eembed_diy_ converters, and nothing allocates or locks,
+ * thus an fd log may be used from a signal handler or crash path. An append
+ * which does not fit is written together with the buffered bytes by a single
+ * writev call. The "fd" must remain valid for the life of the log. */
+#ifndef Eembed_use_fd_log
+#if (EEMBED_HOSTED && defined(__unix__))
+#define Eembed_use_fd_log 1
+#else
+#define Eembed_use_fd_log 0
+#endif
+#endif
+
+#if Eembed_use_fd_log
+struct eembed_log *eembed_fd_log_init(struct eembed_log *log,
+				      struct eembed_buffered_log *ctx,
+				      char *buf, size_t size, int *fd);
+
+/* the write function of an fd log, the "sink" is an (int *) */
+void eembed_fd_write(void *sink, const char *bytes, size_t len);
+#endif
+
+/* On unix-like hosted systems, an mmap log appends into a shared mapping
+ * of a file: a line costs a memcpy, not a system call. The file is grown
+ * (and re-mapped) "grow_by" bytes at a time, thus a larger "grow_by" means
+ * fewer re-maps; zero means one MiB. As the bytes are in the page cache, the
+ * output survives a crash of the process.
+ *
+ * eembed_mmap_log_flush trims the file to the bytes which were logged; a
+ * later append grows it again. Opening adds a flush hook which does this at
+ * an eembed_assert crash or at exit, and closing flushes and removes it. If
+ * the process dies without running the hooks, the file is left padded with
+ * zero bytes up to a multiple of "grow_by": the logged text ends at the
+ * first zero byte (unless the zero bytes were logged with append_n). */
+#ifndef Eembed_use_mmap_log
+#define Eembed_use_mmap_log Eembed_use_fd_log
+#endif
+
+#if Eembed_use_mmap_log
+struct eembed_mmap_log {
+	int fd;
+	char *map;
+	size_t mapped;
+	size_t used;
+	size_t grow_by;
+	struct eembed_flush_hook flush_hook;
+};
+
+/* returns NULL if the file could not be opened or mapped */
+struct eembed_log *eembed_mmap_log_open(struct eembed_log *log,
+					struct eembed_mmap_log *ctx,
+					const char *path, size_t grow_by);
+
+/* returns non-zero if the file could not be trimmed */
+int eembed_mmap_log_flush(struct eembed_mmap_log *ctx);
+
+/* returns non-zero if the file could not be trimmed or closed */
+int eembed_mmap_log_close(struct eembed_mmap_log *ctx);
+#endif
+
 #ifndef print_s
 #define print_s(s) eembed_out_log->append_s(eembed_out_log, s)
 #endif
@@ -1013,6 +1603,7 @@ struct eembed_log *eembed_char_buf_log_init(struct eembed_log *log,
 				el->append_s(el, ") FAILED"); \
 				el->append_eol(el); \
 			} \
+			eembed_flush_hooks_run(); \
 			eembed_assert_crash(); \
 		} \
 	} while (0)
@@ -1025,6 +1616,78 @@ struct eembed_log *eembed_char_buf_log_init(struct eembed_log *log,
 #endif
 #endif
 
+/***************************************************************************\
+ * Leveled logging: the statement of a level above Eembed_log_level_max is
+ * removed by the preprocessor, thus costs nothing; the statement of an
+ * enabled level runs only if the level is at or below eembed_log_level,
+ * which may be changed at runtime. e.g.:
+ *	eembed_debug(print_s("x: "); print_ul(x); print_eol());
+\***************************************************************************/
+#define eembed_log_level_error 1
+#define eembed_log_level_warn 2
+#define eembed_log_level_info 3
+#define eembed_log_level_debug 4
+#define eembed_log_level_trace 5
+
+#ifndef Eembed_log_level_max
+#ifdef NDEBUG
+#define Eembed_log_level_max eembed_log_level_info
+#else
+#define Eembed_log_level_max eembed_log_level_trace
+#endif
+#endif
+
+/* defaults to eembed_log_level_info */
+extern unsigned char eembed_log_level;
+
+/* the level of the statement which is running on this thread, otherwise
+ * zero; per-thread where EEMBED_THREAD_LOCAL is supported */
+extern EEMBED_THREAD_LOCAL unsigned char eembed_log_message_level;
+
+#define eembed_log_if_level(level, statement) \
+	do { \
+		if ((level) <= eembed_log_level) { \
+			eembed_log_message_level = (level); \
+			statement; \
+			eembed_log_message_level = 0; \
+		} \
+	} while (0)
+
+#if (Eembed_log_level_max >= eembed_log_level_error)
+#define eembed_error(statement) \
+	eembed_log_if_level(eembed_log_level_error, statement)
+#else
+#define eembed_error(statement) EEMBED_NOP()
+#endif
+
+#if (Eembed_log_level_max >= eembed_log_level_warn)
+#define eembed_warn(statement) \
+	eembed_log_if_level(eembed_log_level_warn, statement)
+#else
+#define eembed_warn(statement) EEMBED_NOP()
+#endif
+
+#if (Eembed_log_level_max >= eembed_log_level_info)
+#define eembed_info(statement) \
+	eembed_log_if_level(eembed_log_level_info, statement)
+#else
+#define eembed_info(statement) EEMBED_NOP()
+#endif
+
+#if (Eembed_log_level_max >= eembed_log_level_debug)
+#define eembed_debug(statement) \
+	eembed_log_if_level(eembed_log_level_debug, statement)
+#else
+#define eembed_debug(statement) EEMBED_NOP()
+#endif
+
+#if (Eembed_log_level_max >= eembed_log_level_trace)
+#define eembed_trace(statement) \
+	eembed_log_if_level(eembed_log_level_trace, statement)
+#else
+#define eembed_trace(statement) EEMBED_NOP()
+#endif
+
 #define eembed_concat(a,b) a##b
 
 /* without the two layers here, eembed_concat(foo, __LINE__) would result in
@@ -1113,17 +1776,26 @@ struct eembed_function_context {
  * EEMBED_FUNC_MAIN(name_of_main_inner) provides a way to handle both cases.
 \***************************************************************************/
 /* This function exists to allow freestanding systems to initialize
- * printing, this can be useful in FAUX_FREESTANDING test builds. */
+ * printing, this can be useful in FAUX_FREESTANDING test builds.
+ * In FAUX_FREESTANDING builds, the output is collected in a line buffer
+ * which is written at each eol (or when full), as a serial driver would. */
 void eembed_system_print_init(void);
 
+#ifndef Eembed_faux_freestanding_line_size
+#define Eembed_faux_freestanding_line_size 128
+#endif
+
 #if (EEMBED_HOSTED || FAUX_FREESTANDING)
 
 #ifndef EEMBED_FUNC_MAIN
 #define EEMBED_FUNC_MAIN(pfunc) \
 int main(void) \
 { \
+	int rv = 0; \
 	eembed_system_print_init(); \
-	return pfunc() ? 1 : 0; \
+	rv = pfunc() ? 1 : 0; \
+	eembed_flush_hooks_run(); \
+	return rv; \
 }
 #endif
 
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* bench-eembed-mem.c: the diy memory functions compared to the libc ones */
+/* Copyright (C) 2017-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define Bench_max_size 65536
+#define Bench_bytes_per_run (64UL * 1024UL * 1024UL)
+
+typedef void *(*bench_copy_func)(void *dest, const void *src, size_t n);
+typedef void *(*bench_set_func)(void *dest, int val, size_t n);
+typedef void *(*bench_chr_func)(const void *s, int c, size_t n);
+typedef size_t (*bench_len_func)(const char *s, size_t n);
+
+/* called through volatile pointers so that the compiler may not replace the
+ * libc calls with inline code */
+static volatile bench_copy_func bench_libc_memcpy = memcpy;
+static volatile bench_copy_func bench_libc_memmove = memmove;
+static volatile bench_set_func bench_libc_memset = memset;
+static volatile bench_copy_func bench_diy_memcpy = eembed_diy_memcpy;
+static volatile bench_copy_func bench_diy_memmove = eembed_diy_memmove;
+static volatile bench_set_func bench_diy_memset = eembed_diy_memset;
+static volatile bench_chr_func bench_libc_memchr = memchr;
+static volatile bench_chr_func bench_diy_memchr = eembed_diy_memchr;
+static volatile bench_len_func bench_libc_strnlen = strnlen;
+static volatile bench_len_func bench_diy_strnlen = eembed_diy_strnlen;
+
+static unsigned char bench_src[Bench_max_size + 64];
+static unsigned char bench_dest[Bench_max_size + 64];
+
+static unsigned long bench_mb_per_sec(uint64_t bytes, uint64_t ns)
+{
+	if (!ns) {
+		ns = 1;
+	}
+	return (unsigned long)((bytes * 1000U) / ns);
+}
+
+static uint64_t bench_copy(bench_copy_func copy, size_t size, size_t offset)
+{
+	uint64_t start, runs, i;
+
+	runs = (Bench_bytes_per_run / size) + 1;
+	start = eembed_hosted_uptime_ns();
+	for (i = 0; i < runs; ++i) {
+		copy(bench_dest + offset, bench_src, size);
+	}
+	return eembed_hosted_uptime_ns() - start;
+}
+
+static uint64_t bench_set(bench_set_func set, size_t size, size_t offset)
+{
+	uint64_t start, runs, i;
+
+	runs = (Bench_bytes_per_run / size) + 1;
+	start = eembed_hosted_uptime_ns();
+	for (i = 0; i < runs; ++i) {
+		set(bench_dest + offset, (int)(i & 0xFF), size);
+	}
+	return eembed_hosted_uptime_ns() - start;
+}
+
+/* the source has no zero bytes and no 0xFF bytes, thus both the memchr and
+ * the strnlen scan the whole size */
+static uint64_t bench_chr(bench_chr_func chr, size_t size, size_t offset)
+{
+	uint64_t start, runs, i;
+
+	runs = (Bench_bytes_per_run / size) + 1;
+	start = eembed_hosted_uptime_ns();
+	for (i = 0; i < runs; ++i) {
+		chr(bench_src + offset, 0xFF, size);
+	}
+	return eembed_hosted_uptime_ns() - start;
+}
+
+static uint64_t bench_len(bench_len_func len, size_t size, size_t offset)
+{
+	uint64_t start, runs, i;
+
+	runs = (Bench_bytes_per_run / size) + 1;
+	start = eembed_hosted_uptime_ns();
+	for (i = 0; i < runs; ++i) {
+		len((const char *)bench_src + offset, size);
+	}
+	return eembed_hosted_uptime_ns() - start;
+}
+
+static void bench_report(const char *name, size_t size, size_t offset,
+			 uint64_t libc_ns, uint64_t diy_ns)
+{
+	uint64_t bytes;
+
+	bytes = ((Bench_bytes_per_run / size) + 1) * size;
+	printf("%-8s %6lu +%lu  libc: %6lu MB/s  diy: %6lu MB/s\n",
+	       name, (unsigned long)size, (unsigned long)offset,
+	       bench_mb_per_sec(bytes, libc_ns),
+	       bench_mb_per_sec(bytes, diy_ns));
+}
+
+int main(void)
+{
+	size_t sizes[] = { 8, 64, 512, 4096, Bench_max_size };
+	size_t offsets[] = { 0, 1 };
+	size_t i, j, size, offset;
+	uint64_t libc_ns, diy_ns;
+
+	for (i = 0; i < sizeof(bench_src); ++i) {
+		bench_src[i] = (unsigned char)(1 + (i % 0xFE));
+	}
+
+	for (j = 0; j < (sizeof(offsets) / sizeof(offsets[0])); ++j) {
+		offset = offsets[j];
+		for (i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); ++i) {
+			size = sizes[i];
+			libc_ns = bench_copy(bench_libc_memcpy, size, offset);
+			diy_ns = bench_copy(bench_diy_memcpy, size, offset);
+			bench_report("memcpy", size, offset, libc_ns, diy_ns);
+
+			libc_ns = bench_copy(bench_libc_memmove, size, offset);
+			diy_ns = bench_copy(bench_diy_memmove, size, offset);
+			bench_report("memmove", size, offset, libc_ns, diy_ns);
+
+			libc_ns = bench_set(bench_libc_memset, size, offset);
+			diy_ns = bench_set(bench_diy_memset, size, offset);
+			bench_report("memset", size, offset, libc_ns, diy_ns);
+
+			libc_ns = bench_chr(bench_libc_memchr, size, offset);
+			diy_ns = bench_chr(bench_diy_memchr, size, offset);
+			bench_report("memchr", size, offset, libc_ns, diy_ns);
+
+			libc_ns = bench_len(bench_libc_strnlen, size, offset);
+			diy_ns = bench_len(bench_diy_strnlen, size, offset);
+			bench_report("strnlen", size, offset, libc_ns, diy_ns);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* decode-eembed-binary-log.c: renders a binary log file as text */
+/* Copyright (C) 2025 Eric Herman <eric@freesa.org> */
+
+/* usage: decode-eembed-binary-log LOG_FILE [STRINGS_FILE]
+ *
+ * The records of LOG_FILE are written as text to stdout. If the logging
+ * system had a "strings" table, the STRINGS_FILE has one string per line,
+ * in the order of the table, so that the string indexes may be decoded.
+ * Bytes at the end of the file which are not a complete record (as when
+ * the logging system stopped mid-record) are reported on stderr. */
+
+#include "eembed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the whole file, plus a terminating NUL, or NULL on error */
+static char *decode_read_file(const char *path, size_t *len)
+{
+	FILE *file = NULL;
+	char *buf = NULL;
+	char *grown = NULL;
+	size_t size = 4096;
+	size_t got = 0;
+
+	*len = 0;
+	file = fopen(path, "rb");
+	if (!file) {
+		perror(path);
+		return NULL;
+	}
+	buf = (char *)malloc(size);
+	while (buf && (got = fread(buf + *len, 1, size - *len - 1, file))) {
+		*len += got;
+		if ((size - *len) == 1) {
+			size *= 2;
+			grown = (char *)realloc(buf, size);
+			if (!grown) {
+				free(buf);
+			}
+			buf = grown;
+		}
+	}
+	if (!buf || ferror(file)) {
+		perror(path);
+		free(buf);
+		buf = NULL;
+	} else {
+		buf[*len] = '\0';
+	}
+	fclose(file);
+	return buf;
+}
+
+/* splits the text into lines, in place; returns NULL on error. Only a
+ * newline starts a new line, thus a line which holds a zero byte is
+ * merely cut short by it. */
+static const char **decode_strings(char *text, size_t len, size_t *count)
+{
+	const char **strings = NULL;
+	size_t i = 0;
+	size_t n = 0;
+	int line_start = 1;
+
+	for (i = 0; i < len; ++i) {
+		n += line_start ? 1 : 0;
+		line_start = (text[i] == '\n');
+	}
+
+	strings = (const char **)malloc((n ? n : 1) * sizeof(const char *));
+	if (!strings) {
+		return NULL;
+	}
+	*count = 0;
+	line_start = 1;
+	for (i = 0; i < len; ++i) {
+		if (line_start && *count < n) {
+			strings[(*count)++] = text + i;
+		}
+		line_start = (text[i] == '\n');
+		if (line_start) {
+			text[i] = '\0';
+		}
+	}
+	return strings;
+}
+
+int main(int argc, char **argv)
+{
+	char *log_bytes = NULL;
+	char *strings_text = NULL;
+	const char **strings = NULL;
+	size_t log_len = 0;
+	size_t strings_len = 0;
+	size_t text_len = 0;
+	size_t decoded = 0;
+	int err = EXIT_SUCCESS;
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: %s LOG_FILE [STRINGS_FILE]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	log_bytes = decode_read_file(argv[1], &log_len);
+	if (!log_bytes) {
+		return EXIT_FAILURE;
+	}
+	if (argc == 3) {
+		strings_text = decode_read_file(argv[2], &text_len);
+		strings = strings_text
+		    ? decode_strings(strings_text, text_len, &strings_len)
+		    : NULL;
+		if (!strings) {
+			free(strings_text);
+			free(log_bytes);
+			return EXIT_FAILURE;
+		}
+	}
+
+	decoded = eembed_binary_log_decode(eembed_out_log,
+					   (const unsigned char *)log_bytes,
+					   log_len, strings, strings_len);
+	if (decoded < log_len) {
+		fprintf(stderr, "%s: %lu bytes at offset %lu not decoded\n",
+			argv[1], (unsigned long)(log_len - decoded),
+			(unsigned long)decoded);
+		err = EXIT_FAILURE;
+	}
+
+	free((void *)strings);
+	free(strings_text);
+	free(log_bytes);
+	return err;
+}
@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+#if Eembed_use_async_log
+
+extern int (*eembed_pthread_create)(pthread_t *thread,
+				    const pthread_attr_t *attr,
+				    void *(*start)(void *), void *arg);
+
+static int test_pthread_create_fails(pthread_t *thread,
+				     const pthread_attr_t *attr,
+				     void *(*start)(void *), void *arg)
+{
+	(void)thread;
+	(void)attr;
+	(void)start;
+	(void)arg;
+	return 1;
+}
+
+struct test_sink {
+	unsigned long lines;
+	unsigned long out_of_order;
+	unsigned long next;
+};
+
+/* a slow sink, so that the ring will fill */
+static void test_sink_append_s(struct eembed_log *log, const char *str)
+{
+	struct test_sink *sink = (struct test_sink *)log->context;
+	char expect[25];
+
+	eembed_ulong_to_str(expect, sizeof(expect), sink->next++);
+	if (eembed_strcmp(str, expect)) {
+		++sink->out_of_order;
+	}
+	delay_ms_u16(1);
+}
+
+static void test_sink_append_eol(struct eembed_log *log)
+{
+	struct test_sink *sink = (struct test_sink *)log->context;
+	__atomic_add_fetch(&sink->lines, 1, __ATOMIC_SEQ_CST);
+}
+
+static unsigned test_async_log(unsigned char block_when_full)
+{
+	struct eembed_ring_log_slot slots[2];
+	struct eembed_async_log ctx;
+	struct eembed_log alog;
+	struct eembed_log *log = NULL;
+	struct test_sink sink;
+	struct eembed_log slog;
+	unsigned long i = 0;
+	unsigned failures = 0;
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	slog = *eembed_null_log;
+	slog.context = &sink;
+	slog.append_s = test_sink_append_s;
+	slog.append_eol = test_sink_append_eol;
+
+	log = eembed_async_log_start(&alog, &ctx, slots, 2, &slog,
+				     block_when_full);
+	if (!log) {
+		return 1;
+	}
+	/* let the writer go idle */
+	delay_ms_u16(3);
+	for (i = 0; i < 20; ++i) {
+		log->append_ul(log, i);
+		log->append_eol(log);
+	}
+	eembed_async_log_stop(&ctx);
+	eembed_async_log_stop(&ctx);
+
+	/* after stopping, lines are dropped rather than queued or blocking */
+	log->append_ul(log, i);
+	log->append_eol(log);
+	log->append_ul(log, i);
+	log->append_eol(log);
+	log->append_ul(log, i);
+	log->append_eol(log);
+
+	if (block_when_full) {
+		failures += (sink.lines == 20) ? 0 : 1;
+		failures += (sink.out_of_order == 0) ? 0 : 1;
+		failures += (ctx.ring.dropped == 3) ? 0 : 1;
+	} else {
+		failures += (sink.lines < 20) ? 0 : 1;
+		failures += ((sink.lines + ctx.ring.dropped) == 23) ? 0 : 1;
+	}
+
+	return failures;
+}
+
+/* an idle writer sleeps until woken by the next line, rather than polling */
+static unsigned test_async_log_wakes_writer(void)
+{
+	struct eembed_ring_log_slot slots[4];
+	struct eembed_async_log ctx;
+	struct eembed_log alog;
+	struct eembed_log *log = NULL;
+	struct test_sink sink;
+	struct eembed_log slog;
+	unsigned long waited = 0;
+	unsigned failures = 0;
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	slog = *eembed_null_log;
+	slog.context = &sink;
+	slog.append_s = test_sink_append_s;
+	slog.append_eol = test_sink_append_eol;
+
+	log = eembed_async_log_start(&alog, &ctx, slots, 4, &slog, 0);
+	if (!log) {
+		return 1;
+	}
+	/* wait for the writer to go to sleep */
+	while (!__atomic_load_n(&ctx.writer_waiting, __ATOMIC_SEQ_CST)
+	       && waited++ < 1000) {
+		delay_ms_u16(1);
+	}
+	failures += (waited < 1000) ? 0 : 1;
+
+	log->append_ul(log, 0);
+	log->append_eol(log);
+	waited = 0;
+	while (!__atomic_load_n(&sink.lines, __ATOMIC_SEQ_CST)
+	       && waited++ < 1000) {
+		delay_ms_u16(1);
+	}
+	failures += (waited < 1000) ? 0 : 1;
+
+	eembed_async_log_stop(&ctx);
+	failures += (sink.lines == 1) ? 0 : 1;
+	failures += (ctx.started == 0) ? 0 : 1;
+
+	return failures;
+}
+
+static struct eembed_async_log *test_self_stop_ctx = NULL;
+static int test_self_stopped = 0;
+
+/* as a flush hook would, if the sink crashed on the writer thread */
+static void test_self_stop_append_eol(struct eembed_log *log)
+{
+	(void)log;
+	eembed_async_log_stop(test_self_stop_ctx);
+	__atomic_store_n(&test_self_stopped, 1, __ATOMIC_SEQ_CST);
+}
+
+static unsigned test_async_log_stopped_by_writer(void)
+{
+	static struct eembed_ring_log_slot slots[4];
+	static struct eembed_async_log ctx;
+	static struct eembed_log alog;
+	static struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	unsigned long waited = 0;
+	unsigned failures = 0;
+
+	slog = *eembed_null_log;
+	slog.append_eol = test_self_stop_append_eol;
+	test_self_stop_ctx = &ctx;
+
+	log = eembed_async_log_start(&alog, &ctx, slots, 4, &slog, 1);
+	if (!log) {
+		return 1;
+	}
+	log->append_s(log, "stop");
+	log->append_eol(log);
+	while (!__atomic_load_n(&test_self_stopped, __ATOMIC_SEQ_CST)
+	       && waited++ < 1000) {
+		delay_ms_u16(1);
+	}
+	failures += (waited < 1000) ? 0 : 1;
+	failures += (ctx.started == 0) ? 0 : 1;
+
+	/* the detached writer is not joined again */
+	eembed_async_log_stop(&ctx);
+	log->append_s(log, "dropped");
+	log->append_eol(log);
+	failures += (ctx.ring.dropped == 1) ? 0 : 1;
+
+	return failures;
+}
+
+static unsigned test_async_log_at_exit(void)
+{
+	static struct eembed_ring_log_slot slots[4];
+	static struct eembed_async_log ctx;
+	static struct eembed_log alog;
+	struct eembed_log *log = NULL;
+
+	/* left running, to be stopped by the flush hooks at exit */
+	log = eembed_async_log_start(&alog, &ctx, slots, 4, eembed_null_log,
+				     1);
+	if (!log) {
+		return 1;
+	}
+	log->append_s(log, "at exit");
+	log->append_eol(log);
+	return 0;
+}
+
+unsigned int test_eembed_async_log(void)
+{
+	struct eembed_ring_log_slot slots[2];
+	struct eembed_async_log ctx;
+	struct eembed_log alog;
+	struct eembed_log *log = NULL;
+	unsigned failures = 0;
+
+	log = eembed_async_log_start(&alog, NULL, slots, 2, eembed_null_log, 0);
+	failures += (log == NULL) ? 0 : 1;
+
+	eembed_pthread_create = test_pthread_create_fails;
+	log = eembed_async_log_start(&alog, &ctx, slots, 2, eembed_null_log, 0);
+	eembed_pthread_create = pthread_create;
+	failures += (log == NULL) ? 0 : 1;
+	failures += (ctx.started == 0) ? 0 : 1;
+	eembed_async_log_stop(&ctx);
+
+	failures += test_async_log(1);
+	failures += test_async_log(0);
+	failures += test_async_log_wakes_writer();
+	failures += test_async_log_stopped_by_writer();
+	failures += test_async_log_at_exit();
+
+	return failures;
+}
+#else
+unsigned int test_eembed_async_log(void)
+{
+	return 0;
+}
+#endif
+
+EEMBED_FUNC_MAIN(test_eembed_async_log)
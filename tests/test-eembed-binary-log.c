@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+#include "test-eembed-log-util.h"
+
+static const char *test_strings[] = { "FAIL:", " Expected " };
+
+static void test_log_all(struct eembed_log *log)
+{
+	log->append_s(log, test_strings[1]);
+	log->append_s(log, "a string longer than the decode chunk size");
+	log->append_s(log, NULL);
+	log->append_c(log, 'c');
+	log->append_ul(log, 0);
+	log->append_c(log, ' ');
+	log->append_ul(log, UINT64_MAX);
+	log->append_c(log, ' ');
+	log->append_l(log, -1);
+	log->append_c(log, ' ');
+	log->append_l(log, INT64_MIN);
+	log->append_c(log, ' ');
+	log->append_l(log, 300);
+	log->append_c(log, ' ');
+	log->append_f(log, 0.5);
+	log->append_c(log, ' ');
+	log->append_fd(log, -2.25, 2);
+	log->append_c(log, ' ');
+	log->append_vp(log, (void *)0x1234);
+	log->append_eol(log);
+}
+
+static unsigned test_decode_errors(void)
+{
+	char text[80];
+	struct eembed_str_buf sctx;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	unsigned char bytes[16];
+	float flt = 1.5;
+	unsigned failures = 0;
+
+	text[0] = '\0';
+	log = eembed_char_buf_log_init(&slog, &sctx, text, sizeof(text));
+
+	/* string ids are rendered, or "?" if not in the table */
+	bytes[0] = eembed_binary_log_tag_id;
+	bytes[1] = 0;
+	bytes[2] = eembed_binary_log_tag_id;
+	bytes[3] = 7;
+	failures += (eembed_binary_log_decode(log, bytes, 4, test_strings, 2)
+		     == 4) ? 0 : 1;
+	failures += (eembed_binary_log_decode(log, bytes, 2, NULL, 2)
+		     == 2) ? 0 : 1;
+	failures += eembed_strcmp(text, "FAIL:??") ? 1 : 0;
+
+	/* a float of a system where double is the size of a float */
+	eembed_str_buf_reset(&sctx);
+	bytes[0] = eembed_binary_log_tag_f;
+	bytes[1] = sizeof(float);
+	eembed_memcpy(bytes + 2, &flt, sizeof(float));
+	failures += (eembed_binary_log_decode(log, bytes, 2 + sizeof(float),
+					      NULL, 0) == 6) ? 0 : 1;
+	failures += eembed_strncmp(text, "1.5", 3) ? 1 : 0;
+
+	/* incomplete or unknown records stop the decoding */
+	bytes[0] = eembed_binary_log_tag_c;
+	failures += eembed_binary_log_decode(log, bytes, 1, NULL, 0);
+	bytes[0] = eembed_binary_log_tag_fd;
+	failures += eembed_binary_log_decode(log, bytes, 1, NULL, 0);
+	bytes[1] = 2;
+	bytes[2] = 3;
+	failures += eembed_binary_log_decode(log, bytes, 3, NULL, 0);
+	bytes[2] = sizeof(double);
+	failures += eembed_binary_log_decode(log, bytes, 5, NULL, 0);
+	bytes[0] = eembed_binary_log_tag_ul;
+	bytes[1] = 0x80;
+	failures += eembed_binary_log_decode(log, bytes, 2, NULL, 0);
+	bytes[0] = eembed_binary_log_tag_s;
+	bytes[1] = 5;
+	failures += eembed_binary_log_decode(log, bytes, 4, NULL, 0);
+	bytes[0] = 'x';
+	bytes[1] = 1;
+	failures += eembed_binary_log_decode(log, bytes, 2, NULL, 0);
+
+	return failures;
+}
+
+unsigned int test_eembed_binary_log(void)
+{
+	char buf[16];
+	char expected[250];
+	char actual[250];
+	struct eembed_binary_log ctx;
+	struct eembed_log blog;
+	struct eembed_str_buf sctx;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	struct test_sink sink;
+	const unsigned char *bytes = NULL;
+	size_t decoded = 0;
+	unsigned failures = 0;
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	expected[0] = '\0';
+	actual[0] = '\0';
+
+	log = eembed_binary_log_init(&blog, NULL, buf, sizeof(buf),
+				     test_sink_write, &sink, NULL, 0);
+	failures += (log == NULL) ? 0 : 1;
+
+	log = eembed_binary_log_init(&blog, &ctx, buf, sizeof(buf),
+				     test_sink_write, &sink, test_strings, 2);
+	ctx.out.flush_on_eol = 1;
+	test_log_all(log);
+	log->append_eol(log);
+	ctx.out.flush_on_eol = 0;
+	log->append_eol(log);
+	eembed_buffered_log_flush(&ctx.out);
+
+	log = eembed_char_buf_log_init(&slog, &sctx, expected,
+				       sizeof(expected));
+	test_log_all(log);
+	log->append_eol(log);
+	log->append_eol(log);
+
+	log = eembed_char_buf_log_init(&slog, &sctx, actual, sizeof(actual));
+	bytes = (const unsigned char *)sink.bytes;
+	decoded = eembed_binary_log_decode(log, bytes, sink.len, test_strings,
+					   2);
+	failures += (decoded == sink.len) ? 0 : 1;
+	if (eembed_strcmp(expected, actual)) {
+		print_err_s("expected '");
+		print_err_s(expected);
+		print_err_s("' but was '");
+		print_err_s(actual);
+		print_err_s("'");
+		print_err_eol();
+		++failures;
+	}
+	/* the records are smaller than the text */
+	failures += (sink.len < eembed_strlen(expected)) ? 0 : 1;
+
+	failures += test_decode_errors();
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_binary_log)
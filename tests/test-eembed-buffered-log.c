@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+#include "test-eembed-log-util.h"
+
+static unsigned test_hook_calls = 0;
+static void test_hook_flush(void *context)
+{
+	(void)context;
+	++test_hook_calls;
+	/* a nested run is ignored */
+	eembed_flush_hooks_run();
+}
+
+#if EEMBED_HOSTED
+static void *test_tmpfile(void *data)
+{
+	return data;
+}
+
+static unsigned test_buffered_stdio(void)
+{
+	char buf[8];
+	char actual[20];
+	struct eembed_buffered_log ctx;
+	struct eembed_log llog;
+	struct eembed_log *log = NULL;
+	struct eembed_function_context fctx = { NULL, test_tmpfile };
+	size_t len = 0;
+
+	fctx.data = tmpfile();
+	if (!fctx.data) {
+		return 0;
+	}
+	log = eembed_buffered_log_init(&llog, &ctx, buf, sizeof(buf),
+				       eembed_stdio_write, &fctx);
+	log->append_s(log, "to file");
+	log->append_eol(log);
+	eembed_buffered_log_flush(&ctx);
+
+	rewind((FILE *)fctx.data);
+	len = fread(actual, 1, sizeof(actual) - 1, (FILE *)fctx.data);
+	actual[len] = '\0';
+	fclose((FILE *)fctx.data);
+
+	return eembed_strcmp(actual, "to file\n") ? 1 : 0;
+}
+#else
+static unsigned test_buffered_stdio(void)
+{
+	return 0;
+}
+#endif
+
+unsigned int test_eembed_buffered_log(void)
+{
+	char buf[8];
+	struct eembed_buffered_log ctx;
+	struct eembed_log llog;
+	struct eembed_log *log = NULL;
+	struct test_sink sink;
+	struct eembed_flush_hook other = { test_hook_flush, NULL, NULL };
+	unsigned failures = 0;
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+
+	log = eembed_buffered_log_init(NULL, &ctx, buf, sizeof(buf),
+				       test_sink_write, &sink);
+	failures += (log == NULL) ? 0 : 1;
+
+	log = eembed_buffered_log_init(&llog, &ctx, buf, sizeof(buf),
+				       test_sink_write, &sink);
+	log->append_s(log, "abc");
+	log->append_s(log, NULL);
+	log->append_s(log, "defgh");
+	failures += (sink.writes == 0) ? 0 : 1;
+
+	/* full buffer is written before the next append */
+	log->append_c(log, 'i');
+	failures += (sink.writes == 1) ? 0 : 1;
+	failures += eembed_strcmp(sink.bytes, "abcdefgh") ? 1 : 0;
+
+	/* fill the buffer, then write the too-big remainder directly */
+	log->append_s(log, "jklmnopqrstuvwxyz");
+	failures += (sink.writes == 3) ? 0 : 1;
+	failures += eembed_strcmp(sink.bytes, "abcdefghijklmnopqrstuvwxyz") ?
+	    1 : 0;
+
+	log->append_ul(log, 42);
+	log->append_eol(log);
+	failures += (sink.writes == 3) ? 0 : 1;
+	eembed_buffered_log_flush(&ctx);
+	eembed_buffered_log_flush(&ctx);
+	failures += (sink.writes == 4) ? 0 : 1;
+
+	ctx.flush_on_eol = 1;
+	log->append_l(log, -1);
+	log->append_eol(log);
+	failures += (sink.writes == 5) ? 0 : 1;
+	failures += eembed_strcmp(sink.bytes + 26, "42\n-1\n") ? 1 : 0;
+
+	/* flushed by the hooks, as at a crash or exit */
+	log->append_s(log, "hook");
+	eembed_flush_hook_add(&ctx.flush_hook);
+	eembed_flush_hook_add(&other);
+	eembed_flush_hook_add(&ctx.flush_hook);
+	eembed_flush_hooks_run();
+	failures += (sink.writes == 6) ? 0 : 1;
+	failures += (test_hook_calls == 1) ? 0 : 1;
+
+	eembed_flush_hook_remove(&ctx.flush_hook);
+	eembed_flush_hook_remove(&ctx.flush_hook);
+	log->append_s(log, "gone");
+	eembed_flush_hooks_run();
+	failures += (sink.writes == 6) ? 0 : 1;
+	failures += (test_hook_calls == 2) ? 0 : 1;
+	eembed_flush_hook_remove(&other);
+
+	/* without a buffer, each append is written directly */
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	log = eembed_buffered_log_init(&llog, &ctx, NULL, sizeof(buf),
+				       test_sink_write, &sink);
+	log->append_s(log, "no");
+	log->append_c(log, 'b');
+	failures += (sink.writes == 2) ? 0 : 1;
+	failures += eembed_strcmp(sink.bytes, "nob") ? 1 : 0;
+
+	failures += test_buffered_stdio();
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_buffered_log)
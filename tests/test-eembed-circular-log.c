@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+static unsigned check_dump(const unsigned char *bytes, size_t len,
+			   const char *expected)
+{
+	char actual[80];
+	struct eembed_str_buf sctx;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	size_t dumped = 0;
+
+	actual[0] = '\0';
+	log = eembed_char_buf_log_init(&slog, &sctx, actual, sizeof(actual));
+	dumped = eembed_circular_log_dump(log, bytes, len);
+	if (eembed_strcmp(expected, actual)
+	    || dumped != eembed_strlen(expected)) {
+		print_err_s("expected '");
+		print_err_s(expected);
+		print_err_s("' but was '");
+		print_err_s(actual);
+		print_err_s("'");
+		print_err_eol();
+		return 1;
+	}
+	return 0;
+}
+
+unsigned test_eembed_circular_log(void)
+{
+	/* uint32_t for alignment; 40 bytes of text after the header */
+	uint32_t buf[14];
+	unsigned char *bytes = (unsigned char *)buf;
+	size_t len = sizeof(buf);
+	struct eembed_log clog;
+	struct eembed_log *log = NULL;
+	struct eembed_circular_log_header *header = NULL;
+	unsigned failures = 0;
+
+	eembed_memset(buf, 0xFF, sizeof(buf));
+
+	failures += eembed_circular_log_init(NULL, bytes, len) ? 1 : 0;
+	failures += eembed_circular_log_init(&clog, NULL, len) ? 1 : 0;
+	failures += eembed_circular_log_init(&clog, bytes, 16) ? 1 : 0;
+	eembed_circular_log_clear(NULL, len);
+	eembed_circular_log_clear(bytes, 16);
+
+	/* garbage is not a valid log */
+	failures += check_dump(bytes, len, "");
+
+	log = eembed_circular_log_init(&clog, bytes, len);
+	failures += (log == &clog) ? 0 : 1;
+	failures += check_dump(bytes, len, "");
+	failures += check_dump(NULL, len, "");
+	failures += check_dump(bytes, 16, "");
+	failures += (eembed_circular_log_dump(NULL, bytes, len) == 0) ? 0 : 1;
+
+	log->append_s(log, "a=");
+	log->append_ul(log, 1);
+	log->append_c(log, ' ');
+	log->append_s(log, NULL);
+	log->append_eol(log);
+	failures += check_dump(bytes, len, "a=1 \n");
+
+	/* after a "restart", the contents are still there */
+	log = eembed_circular_log_init(&clog, bytes, len);
+	log->append_s(log, "0123456789012345678901234567890123456789");
+	failures += check_dump(bytes, len,
+			       "0123456789012345678901234567890123456789");
+	log->append_s(log, "abc");
+	failures += check_dump(bytes, len,
+			       "3456789012345678901234567890123456789abc");
+
+	/* only the tail of a large string fits */
+	log->append_s(log, "xx0123456789012345678901234567890123456789");
+	failures += check_dump(bytes, len,
+			       "0123456789012345678901234567890123456789");
+
+	/* a different size is not the same log */
+	log = eembed_circular_log_init(&clog, bytes, len - 4);
+	failures += check_dump(bytes, len - 4, "");
+
+	/* a corrupt position is not trusted */
+	log = eembed_circular_log_init(&clog, bytes, len);
+	log->append_s(log, "ok");
+	failures += check_dump(bytes, len, "ok");
+	header = (struct eembed_circular_log_header *)buf;
+	header->next = header->size;
+	failures += check_dump(bytes, len, "");
+
+	eembed_circular_log_clear(bytes, len);
+	failures += check_dump(bytes, len, "");
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_circular_log)
@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+#include "test-eembed-log-util.h"
+
+static uint64_t test_now = 0;
+
+static uint64_t test_clock(void)
+{
+	return test_now;
+}
+
+unsigned int test_eembed_dedup_log(void)
+{
+	char buf[400];
+	char line[20];
+	struct eembed_str_buf sctx;
+	struct eembed_log slog;
+	struct eembed_log *sink = NULL;
+	struct eembed_dedup_log_entry entries[4];
+	struct eembed_dedup_log ctx;
+	struct eembed_log dlog;
+	struct eembed_log *log = NULL;
+	unsigned long i = 0;
+	unsigned failures = 0;
+
+	buf[0] = '\0';
+	sink = eembed_char_buf_log_init(&slog, &sctx, buf, sizeof(buf));
+
+	failures += eembed_dedup_log_init(NULL, &ctx, line, sizeof(line),
+					  entries, 4, test_clock, sink) ? 1 : 0;
+	failures += eembed_dedup_log_init(&dlog, &ctx, line, sizeof(line),
+					  entries, 0, test_clock, sink) ? 1 : 0;
+
+	/* a single entry, thus every different line takes it over */
+	log = eembed_dedup_log_init(&dlog, &ctx, line, sizeof(line), entries,
+				    1, test_clock, sink);
+	ctx.summary_every = 5;
+	for (i = 0; i < 10; ++i) {
+		log->append_s(log, "FAIL: i=");
+		log->append_ul(log, i);
+		log->append_eol(log);
+	}
+	log->append_s(log, "other");
+	log->append_s(log, NULL);
+	log->append_c(log, ' ');
+	log->append_l(log, -1);
+	log->append_eol(log);
+	eembed_dedup_log_flush(&ctx);
+	failures += check_str("summary", "FAIL: i=0\nFAIL: i=1\nFAIL: i=2\n"
+			      "suppressed 4 similar lines\nFAIL: i=7\n"
+			      "suppressed 2 similar lines\nother -1\n", buf);
+
+	/* the remaining counts are reported by the flush */
+	eembed_str_buf_reset(&sctx);
+	log = eembed_dedup_log_init(&dlog, &ctx, line, sizeof(line), entries,
+				    4, test_clock, sink);
+	ctx.limit = 1;
+	for (i = 0; i < 5; ++i) {
+		log->append_s(log, "a long line, truncated");
+		log->append_fill(log, '.', 3);
+		log->append_f(log, 1.5);
+		log->append_fd(log, 0.5, 1);
+		log->append_vp(log, NULL);
+		log->append_eol(log);
+	}
+	eembed_flush_hook_add(&ctx.flush_hook);
+	eembed_flush_hooks_run();
+	eembed_flush_hook_remove(&ctx.flush_hook);
+	failures += check_str("flush", "a long line, trunca\n"
+			      "suppressed 4 similar lines\n", buf);
+
+	/* the limit is per window, the suppressed count of the old window is
+	 * reported as the next window starts */
+	eembed_str_buf_reset(&sctx);
+	log = eembed_dedup_log_init(&dlog, &ctx, line, sizeof(line), entries,
+				    4, test_clock, sink);
+	ctx.limit = 1;
+	ctx.window_ns = 10;
+	for (i = 0; i < 6; ++i) {
+		test_now = i * 4;
+		log->append_s(log, "tick");
+		log->append_eol(log);
+	}
+	/* at 0 and 12 a window starts, the others are within a window */
+	failures += check_str("window", "tick\nsuppressed 2 similar lines\n"
+			      "tick\n", buf);
+
+	/* a partial line is passed on by the flush */
+	eembed_str_buf_reset(&sctx);
+	log->append_s(log, "no eol");
+	eembed_dedup_log_flush(&ctx);
+	eembed_dedup_log_flush(&ctx);
+	failures += check_str("partial", "suppressed 2 similar lines\n"
+			      "no eol\n", buf);
+
+	/* without a clock, the default is used */
+	log = eembed_dedup_log_init(&dlog, &ctx, line, sizeof(line), entries,
+				    4, NULL, sink);
+	failures += (log && ctx.now_ns) ? 0 : 1;
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_dedup_log)
@@ -0,0 +1,150 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+#if Eembed_use_fd_log
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+extern ssize_t (*eembed_writev)(int fd, const struct iovec *iov, int iovcnt);
+
+static char written[80];
+static size_t written_len = 0;
+static unsigned writev_calls = 0;
+static int writev_errno = 0;
+
+/* writes at most 3 bytes per call, and fails if writev_errno is set */
+static ssize_t test_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	size_t len = 0;
+	int i = 0;
+
+	(void)fd;
+	++writev_calls;
+	if (writev_errno) {
+		errno = writev_errno;
+		writev_errno = (writev_errno == EINTR) ? 0 : writev_errno;
+		return -1;
+	}
+	for (i = 0; i < iovcnt && len < 3; ++i) {
+		if (iov[i].iov_len) {
+			written[written_len++] = *((char *)iov[i].iov_base);
+			++len;
+			if (iov[i].iov_len > 1 && len < 3) {
+				written[written_len++] =
+				    ((char *)iov[i].iov_base)[1];
+				++len;
+			}
+			break;
+		}
+	}
+	written[written_len] = '\0';
+	return (ssize_t)len;
+}
+
+static unsigned test_fd_log_short_writes(void)
+{
+	char buf[8];
+	struct eembed_buffered_log ctx;
+	struct eembed_log llog;
+	struct eembed_log *log = NULL;
+	int fd = -1;
+	unsigned failures = 0;
+
+	eembed_writev = test_writev;
+
+	log = eembed_fd_log_init(&llog, &ctx, buf, sizeof(buf), &fd);
+	log->append_s(log, "abcdef");
+	log->append_s(log, NULL);
+	log->append_n(log, "xyz", 2);
+	log->append_n(log, NULL, 2);
+	failures += (writev_calls == 0) ? 0 : 1;
+
+	/* does not fit, thus written with the buffered bytes */
+	writev_errno = EINTR;
+	log->append_s(log, "ghijk");
+	failures += eembed_strcmp(written, "abcdefxyghijk") ? 1 : 0;
+
+	/* errors are not retried */
+	writev_errno = EBADF;
+	writev_calls = 0;
+	log->append_c(log, 'x');
+	eembed_buffered_log_flush(&ctx);
+	failures += (writev_calls == 1) ? 0 : 1;
+	failures += (errno == EBADF) ? 1 : 0;
+	writev_errno = 0;
+
+	eembed_writev = writev;
+
+	return failures;
+}
+
+unsigned int test_eembed_fd_log(void)
+{
+	char buf[16];
+	char actual[80];
+	struct eembed_buffered_log ctx;
+	struct eembed_log llog;
+	struct eembed_log *log = NULL;
+	int fds[2] = { -1, -1 };
+	ssize_t len = 0;
+	const char *expected = NULL;
+	unsigned failures = 0;
+
+	failures += test_fd_log_short_writes();
+
+	log = eembed_fd_log_init(&llog, &ctx, buf, sizeof(buf), NULL);
+	failures += (log == NULL) ? 0 : 1;
+
+	if (pipe(fds)) {
+		return failures;
+	}
+
+	log = eembed_fd_log_init(&llog, &ctx, buf, sizeof(buf), &fds[1]);
+	log->append_s(log, "ul:");
+	log->append_ul(log, 42);
+	log->append_s(log, " l:");
+	log->append_l(log, -7);
+	log->append_c(log, ' ');
+	log->append_f(log, 1.5);
+	log->append_c(log, ' ');
+	log->append_fd(log, 2.25, 2);
+	log->append_c(log, ' ');
+	log->append_vp(log, (void *)0x10);
+	log->append_eol(log);
+	ctx.flush_on_eol = 1;
+	log->append_eol(log);
+
+	len = read(fds[0], actual, sizeof(actual) - 1);
+	actual[len < 0 ? 0 : len] = '\0';
+	/* the diy float conversions are approximate */
+	expected = "ul:42 l:-7 1.5";
+	if (eembed_strncmp(actual, expected, eembed_strlen(expected))
+	    || !eembed_strstr(actual, " 2.2")
+	    || !eembed_strstr(actual, "010\n\n")) {
+		log = eembed_fd_log_init(&llog, &ctx, NULL, 0, &fds[1]);
+		fds[1] = 2;
+		log->append_s(log, "expected '");
+		log->append_s(log, expected);
+		log->append_s(log, "' but was '");
+		log->append_s(log, actual);
+		log->append_s(log, "'");
+		log->append_eol(log);
+		++failures;
+	}
+
+	close(fds[0]);
+	close(fds[1]);
+
+	return failures;
+}
+#else
+unsigned int test_eembed_fd_log(void)
+{
+	return 0;
+}
+#endif
+
+EEMBED_FUNC_MAIN(test_eembed_fd_log)
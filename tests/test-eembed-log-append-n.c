@@ -0,0 +1,251 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+#include "test-eembed-log-util.h"
+
+static const char *expected_all =
+    "abc----------------------------------------------------------------------"
+    "z\n";
+
+static void test_append_all(struct eembed_log *log)
+{
+	log->append_n(log, "abcdef", 3);
+	log->append_n(log, NULL, 3);
+	log->append_fill(log, '-', 70);
+	log->append_fill(log, '-', 0);
+	log->append_n(log, "z", 1);
+	log->append_eol(log);
+}
+
+static unsigned test_str_buf_append_n(void)
+{
+	char buf[80];
+	char small[10];
+	struct eembed_str_buf ctx;
+	struct eembed_str_buf small_ctx;
+	struct eembed_log llog;
+	struct eembed_log *log = NULL;
+	unsigned failures = 0;
+
+	buf[0] = '\0';
+	log = eembed_char_buf_log_init(&llog, &ctx, buf, sizeof(buf));
+	test_append_all(log);
+	failures += check_str("str_buf", expected_all, buf);
+
+	small[0] = '\0';
+	log = eembed_char_buf_log_init(&llog, &small_ctx, small, sizeof(small));
+	test_append_all(log);
+	log->append_s(log, "q");
+	log->append_s(log, NULL);
+	failures += check_str("str_buf small", "abc------", small);
+
+	/* the generic versions use the append_s */
+	buf[0] = '\0';
+	log = eembed_char_buf_log_init(&llog, &ctx, buf, sizeof(buf));
+	log->append_n = eembed_log_str_append_n;
+	log->append_fill = eembed_log_str_append_fill;
+	test_append_all(log);
+	failures += check_str("generic", expected_all, buf);
+
+	/* longer than the chunks */
+	eembed_str_buf_reset(&ctx);
+	eembed_log_str_append_n(log, "0123456789012345678901234567890123456789"
+				"0123456789012345678901234567890123456789",
+				70);
+	failures += check_str("generic long",
+			      "0123456789012345678901234567890123456789"
+			      "012345678901234567890123456789", buf);
+
+	/* a log without a context is ignored */
+	log = eembed_char_buf_log_init(&llog, &ctx, buf, sizeof(buf));
+	llog.context = NULL;
+	llog.append_n(&llog, "abc", 3);
+	llog.append_fill(&llog, '-', 3);
+
+	return failures;
+}
+
+/* a log written before append_n and append_fill existed, initialized by
+ * position, which leaves the newer members at the end NULL */
+static char old_style_buf[80];
+static size_t old_style_used = 0;
+
+static void old_style_append_c(struct eembed_log *log, char c)
+{
+	(void)log;
+	if (old_style_used < (sizeof(old_style_buf) - 1)) {
+		old_style_buf[old_style_used++] = c;
+		old_style_buf[old_style_used] = '\0';
+	}
+}
+
+static void old_style_append_s(struct eembed_log *log, const char *str)
+{
+	while (str && *str) {
+		old_style_append_c(log, *str++);
+	}
+}
+
+static void old_style_append_ul(struct eembed_log *log, uint64_t ul)
+{
+	(void)log;
+	(void)ul;
+}
+
+static void old_style_append_l(struct eembed_log *log, int64_t l)
+{
+	(void)log;
+	(void)l;
+}
+
+static void old_style_append_f(struct eembed_log *log, long double f)
+{
+	(void)log;
+	(void)f;
+}
+
+static void old_style_append_fd(struct eembed_log *log, long double f,
+				uint8_t d)
+{
+	(void)log;
+	(void)f;
+	(void)d;
+}
+
+static void old_style_append_vp(struct eembed_log *log, const void *ptr)
+{
+	(void)log;
+	(void)ptr;
+}
+
+static void old_style_append_eol(struct eembed_log *log)
+{
+	old_style_append_c(log, '\n');
+}
+
+#if __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#endif
+static struct eembed_log old_style_log = {
+	NULL,
+	old_style_append_c,
+	old_style_append_s,
+	old_style_append_ul,
+	old_style_append_l,
+	old_style_append_f,
+	old_style_append_fd,
+	old_style_append_vp,
+	old_style_append_eol
+};
+#if __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+static unsigned test_old_style_log(void)
+{
+	struct eembed_log *log = &old_style_log;
+	struct eembed_tee_log_sink sinks[1];
+	struct eembed_tee_log tee_ctx;
+	struct eembed_log tee;
+	unsigned failures = 0;
+
+	eembed_crash_if_false(log->append_n == NULL);
+	eembed_crash_if_false(log->append_fill == NULL);
+
+	eembed_log_append_n(log, "abcdef", 3);
+	eembed_log_append_n(log, NULL, 3);
+	eembed_log_append_fill(log, '-', 70);
+	eembed_log_append_fill(log, '-', 0);
+	eembed_log_append_n(log, "z", 1);
+	log->append_eol(log);
+	failures += check_str("old style", expected_all, old_style_buf);
+
+	/* wrapping logs reach the old log through the same fallbacks */
+	old_style_used = 0;
+	old_style_buf[0] = '\0';
+	sinks[0].log = log;
+	sinks[0].level = eembed_log_level_trace;
+	eembed_tee_log_init(&tee, &tee_ctx, sinks, 1);
+	test_append_all(&tee);
+	failures += check_str("old style tee", expected_all, old_style_buf);
+
+	return failures;
+}
+
+static unsigned test_buffered_append_n(void)
+{
+	char buf[16];
+	char actual[200];
+	struct eembed_buffered_log ctx;
+	struct eembed_binary_log bctx;
+	struct eembed_str_buf sctx;
+	struct eembed_log llog;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	struct test_sink sink;
+	unsigned failures = 0;
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	log = eembed_buffered_log_init(&llog, &ctx, buf, sizeof(buf),
+				       test_sink_write, &sink);
+	test_append_all(log);
+	eembed_buffered_log_flush(&ctx);
+	failures += check_str("buffered", expected_all, sink.bytes);
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	log = eembed_binary_log_init(&llog, &bctx, buf, sizeof(buf),
+				     test_sink_write, &sink, NULL, 0);
+	test_append_all(log);
+	eembed_buffered_log_flush(&bctx.out);
+	actual[0] = '\0';
+	log = eembed_char_buf_log_init(&slog, &sctx, actual, sizeof(actual));
+	eembed_binary_log_decode(log, (unsigned char *)sink.bytes, sink.len,
+				 NULL, 0);
+	failures += check_str("binary", expected_all, actual);
+
+	return failures;
+}
+
+static unsigned test_circular_append_n(void)
+{
+	uint32_t bytes[32];
+	char actual[200];
+	struct eembed_str_buf sctx;
+	struct eembed_log clog;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+
+	eembed_circular_log_clear((unsigned char *)bytes, sizeof(bytes));
+	log = eembed_circular_log_init(&clog, (unsigned char *)bytes,
+				       sizeof(bytes));
+	test_append_all(log);
+	actual[0] = '\0';
+	log = eembed_char_buf_log_init(&slog, &sctx, actual, sizeof(actual));
+	eembed_circular_log_dump(log, (unsigned char *)bytes, sizeof(bytes));
+	return check_str("circular", expected_all, actual);
+}
+
+unsigned int test_eembed_log_append_n(void)
+{
+	unsigned failures = 0;
+
+	failures += test_str_buf_append_n();
+	failures += test_buffered_append_n();
+	failures += test_circular_append_n();
+	failures += test_old_style_log();
+
+	eembed_null_log->append_n(eembed_null_log, "abc", 3);
+	eembed_null_log->append_fill(eembed_null_log, '-', 3);
+
+	eembed_out_log->append_n(eembed_out_log, "append_n", 6);
+	eembed_out_log->append_n(eembed_out_log, NULL, 6);
+	eembed_out_log->append_fill(eembed_out_log, '.', 3);
+	eembed_out_log->append_s(eembed_out_log, " ok");
+	eembed_out_log->append_eol(eembed_out_log);
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_log_append_n)
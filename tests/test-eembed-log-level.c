@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+/* trace logging is compiled out of this file */
+#define Eembed_log_level_max eembed_log_level_debug
+#include "eembed.h"
+
+static unsigned logged = 0;
+
+static unsigned log_it(unsigned level)
+{
+	logged = logged | (1U << level);
+	return level;
+}
+
+unsigned int test_eembed_log_level(void)
+{
+	unsigned failures = 0;
+
+	failures += (eembed_log_level == eembed_log_level_info) ? 0 : 1;
+
+	eembed_error(log_it(eembed_log_level_error));
+	eembed_warn(log_it(eembed_log_level_warn));
+	eembed_info(log_it(eembed_log_level_info));
+	eembed_debug(log_it(eembed_log_level_debug));
+	eembed_trace(log_it(eembed_log_level_trace));
+	failures += (logged == 0x0E) ? 0 : 1;
+
+	/* the runtime level does not bring back what was compiled away */
+	logged = 0;
+	eembed_log_level = eembed_log_level_trace;
+	eembed_debug(log_it(eembed_log_level_debug));
+	eembed_trace(log_it(eembed_log_level_trace));
+	failures += (logged == 0x10) ? 0 : 1;
+
+	logged = 0;
+	eembed_log_level = eembed_log_level_error;
+	eembed_error(log_it(eembed_log_level_error); log_it(0));
+	eembed_warn(log_it(eembed_log_level_warn));
+	failures += (logged == 0x03) ? 0 : 1;
+
+	eembed_log_level = eembed_log_level_info;
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_log_level)
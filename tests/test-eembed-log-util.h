@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* test-eembed-log-util.h: helpers shared by the log tests */
+/* Copyright (C) 2025 Eric Herman <eric@freesa.org> */
+
+#ifndef TEST_EEMBED_LOG_UTIL_H
+#define TEST_EEMBED_LOG_UTIL_H 1
+
+#include "eembed.h"
+
+/* not every test uses every helper */
+#if defined(__GNUC__)
+#define Test_eembed_maybe_unused __attribute__((unused))
+#else
+#define Test_eembed_maybe_unused
+#endif
+
+/* returns 0 if the strings match, otherwise reports the difference */
+Test_eembed_maybe_unused
+static unsigned check_str(const char *name, const char *expected,
+			  const char *actual)
+{
+	if (eembed_strcmp(expected, actual) == 0) {
+		return 0;
+	}
+	print_err_s(name);
+	print_err_s(": expected '");
+	print_err_s(expected);
+	print_err_s("' but was '");
+	print_err_s(actual);
+	print_err_s("'");
+	print_err_eol();
+	return 1;
+}
+
+/* collects what a buffered log writes, NUL terminated */
+struct test_sink {
+	char bytes[250];
+	size_t len;
+	unsigned writes;
+};
+
+Test_eembed_maybe_unused
+static void test_sink_write(void *sink, const char *bytes, size_t len)
+{
+	struct test_sink *ts = (struct test_sink *)sink;
+
+	eembed_memcpy(ts->bytes + ts->len, bytes, len);
+	ts->len += len;
+	ts->bytes[ts->len] = '\0';
+	++ts->writes;
+}
+
+#endif /* TEST_EEMBED_LOG_UTIL_H */
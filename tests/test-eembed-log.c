@@ -122,6 +122,54 @@ unsigned int test_eembed_log(void)
 	for (i = 0; i < 10; ++i) {
 		log->append_s(log, "this will run out of space but not crash");
 	}
+	if (eembed_str_buf_len(&bctx) != (buf_len - 1)) {
+		print_err_s("full buffer length ");
+		print_err_ul((unsigned long)eembed_str_buf_len(&bctx));
+		print_err_eol();
+		++failures;
+	}
+	log->append_s(log, NULL);
+
+	eembed_str_buf_reset(&bctx);
+	log->append_s(log, "after");
+	log->append_c(log, ' ');
+	log->append_s(log, "reset");
+	if (eembed_strcmp(buf, "after reset")
+	    || eembed_str_buf_len(&bctx) != 11) {
+		print_err_s("Expected 'after reset' but was '");
+		print_err_s(buf);
+		print_err_s("'");
+		print_err_eol();
+		++failures;
+	}
+
+	/* a buffer cleared by its first byte, without a reset */
+	buf[0] = '\0';
+	log->append_s(log, "bye");
+	if (eembed_strcmp(buf, "bye") || eembed_str_buf_len(&bctx) != 3) {
+		print_err_s("Expected 'bye' but was '");
+		print_err_s(buf);
+		print_err_s("'");
+		print_err_eol();
+		++failures;
+	}
+
+	/* a string already in the buffer is appended to */
+	eembed_strcpy(buf, "pre");
+	log = eembed_char_buf_log_init(&llog, &bctx, buf, buf_len);
+	log->append_s(log, "fix");
+	if (eembed_strcmp(buf, "prefix") || eembed_str_buf_len(&bctx) != 6) {
+		print_err_s("Expected 'prefix' but was '");
+		print_err_s(buf);
+		print_err_s("'");
+		print_err_eol();
+		++failures;
+	}
+
+	if (eembed_str_buf_len(NULL) != 0) {
+		++failures;
+	}
+	eembed_str_buf_reset(NULL);
 
 	eembed_null_log->append_c(eembed_null_log, 'c');
 	eembed_null_log->append_s(eembed_null_log, "str");
@@ -132,7 +180,7 @@ unsigned int test_eembed_log(void)
 	eembed_null_log->append_vp(eembed_null_log, NULL);
 	eembed_null_log->append_eol(eembed_null_log);
 
-	return 0;
+	return failures;
 }
 
 EEMBED_FUNC_MAIN(test_eembed_log)
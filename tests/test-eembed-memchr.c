@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* test-eembed-memchr.c */
+/* Copyright (C) 2017-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+typedef void *(*memchr_func_t)(const void *s, int c, size_t n);
+
+/* the expected result of searching from the front, or from the back */
+static const unsigned char *find_byte(const unsigned char *s, unsigned char c,
+				      size_t n, int reverse)
+{
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		if (s[reverse ? (n - 1 - i) : i] == c) {
+			return s + (reverse ? (n - 1 - i) : i);
+		}
+	}
+	return NULL;
+}
+
+/* every length up to several words, at each alignment, with the byte
+ * absent, first, last, and at each position */
+static void test_memchr_func_sizes(memchr_func_t memchr_func, int reverse)
+{
+	unsigned char buf[96];
+	size_t len, off, pos, i;
+	const unsigned char *expect;
+	void *found;
+
+	for (off = 0; off < 8; ++off) {
+		for (len = 0; len <= 80; ++len) {
+			for (pos = 0; pos <= len + 1; ++pos) {
+				for (i = 0; i < 96; ++i) {
+					buf[i] = (unsigned char)(0x81 + i);
+				}
+				/* another byte with the high bit set */
+				buf[off + (len / 2)] = 0xFF;
+				if (pos < len) {
+					buf[off + pos] = 0x80;
+					buf[off + (len - 1)] = 0x80;
+				}
+				expect = find_byte(buf + off, 0x80, len,
+						   reverse);
+				found = memchr_func(buf + off, 0x80, len);
+				eembed_crash_if_false(found == expect);
+			}
+		}
+	}
+}
+
+unsigned test_eembed_memchr_func(memchr_func_t memchr_func,
+				 memchr_func_t memrchr_func)
+{
+	const char *str = "abcabc";
+	void *found;
+
+	found = memchr_func(str, 'b', 6);
+	eembed_crash_if_false(found == str + 1);
+	found = memrchr_func(str, 'b', 6);
+	eembed_crash_if_false(found == str + 4);
+	found = memchr_func(str, 'z', 6);
+	eembed_crash_if_false(found == NULL);
+	found = memrchr_func(str, 'z', 6);
+	eembed_crash_if_false(found == NULL);
+	found = memchr_func(str, 'c', 2);
+	eembed_crash_if_false(found == NULL);
+	found = memchr_func(str, 'a' + 256, 6);
+	eembed_crash_if_false(found == str);
+	found = memchr_func(str, '\0', 7);
+	eembed_crash_if_false(found == str + 6);
+
+	test_memchr_func_sizes(memchr_func, 0);
+	test_memchr_func_sizes(memrchr_func, 1);
+
+	return 0;
+}
+
+unsigned test_eembed_memchr(void)
+{
+	test_eembed_memchr_func(eembed_memchr, eembed_memrchr);
+	test_eembed_memchr_func(eembed_diy_memchr, eembed_diy_memrchr);
+	return 0;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_memchr)
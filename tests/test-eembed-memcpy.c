@@ -25,6 +25,50 @@ static void test_byte_array(unsigned char *actual, size_t actual_len,
 	}
 }
 
+/* bytes outside of the copied region must remain zero */
+static void check_copied(const unsigned char *dest, size_t d_off,
+			 const unsigned char *src, size_t s_off, size_t len,
+			 size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; ++i) {
+		if (i < d_off || i >= (d_off + len)) {
+			eembed_crash_if_false(dest[i] == 0);
+		} else {
+			eembed_crash_if_false(dest[i] ==
+					      src[(s_off + i) - d_off]);
+		}
+	}
+}
+
+/* every length up to several words, at each alignment of source and dest */
+static void test_memcpy_func_sizes(void *(*memcpy_func)(void *dest,
+							const void *src,
+							size_t n)
+    )
+{
+	unsigned char src[96];
+	unsigned char dest[96];
+	size_t len, s_off, d_off, i;
+	void *rv;
+
+	for (i = 0; i < 96; ++i) {
+		src[i] = (unsigned char)(i + 1);
+	}
+	for (s_off = 0; s_off < 8; ++s_off) {
+		for (d_off = 0; d_off < 8; ++d_off) {
+			for (len = 0; len <= 80; ++len) {
+				eembed_memset(dest, 0, 96);
+				rv = memcpy_func(dest + d_off, src + s_off,
+						 len);
+				eembed_crash_if_false(rv == dest + d_off);
+				check_copied(dest, d_off, src, s_off, len, 96);
+			}
+		}
+	}
+}
+
 unsigned test_eembed_memcpy_func(void *(*memcpy_func)(void *dest,
 						      const void *src, size_t n)
     )
@@ -48,6 +92,8 @@ unsigned test_eembed_memcpy_func(void *(*memcpy_func)(void *dest,
 	test_byte_array(actual, 20, expect, 20);
 	eembed_crash_if_false((void *)rv == (void *)actual);
 
+	test_memcpy_func_sizes(memcpy_func);
+
 	return 0;
 }
 
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* test-eembed-memmem.c */
+/* Copyright (C) 2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+typedef void *(*memmem_func_t)(const void *haystack, size_t haystack_len,
+			       const void *needle, size_t needle_len);
+
+unsigned test_eembed_memmem_func(memmem_func_t memmem_func)
+{
+	const unsigned char haystack[] = { 0x01, 0x00, 0x02, 0x00, 0x00, 0x03,
+		0x00, 0x00, 0x03, 0xFF
+	};
+	const unsigned char needle[] = { 0x00, 0x00, 0x03 };
+	const unsigned char periodic[] = { 0x00, 0x00, 0x00 };
+	const unsigned char last[] = { 0x03, 0xFF };
+	size_t hlen = sizeof(haystack);
+	void *rv;
+
+	rv = memmem_func(haystack, hlen, needle, sizeof(needle));
+	eembed_crash_if_false(rv == haystack + 3);
+
+	rv = memmem_func(haystack + 4, hlen - 4, needle, sizeof(needle));
+	eembed_crash_if_false(rv == haystack + 6);
+
+	rv = memmem_func(haystack, hlen, periodic, sizeof(periodic));
+	eembed_crash_if_false(rv == NULL);
+
+	rv = memmem_func(haystack, hlen, periodic, 2);
+	eembed_crash_if_false(rv == haystack + 3);
+
+	rv = memmem_func(haystack, hlen, last, sizeof(last));
+	eembed_crash_if_false(rv == haystack + 8);
+
+	rv = memmem_func(haystack, hlen - 1, last, sizeof(last));
+	eembed_crash_if_false(rv == NULL);
+
+	rv = memmem_func(haystack, hlen, needle, 0);
+	eembed_crash_if_false(rv == haystack);
+
+	rv = memmem_func(needle, sizeof(needle), haystack, hlen);
+	eembed_crash_if_false(rv == NULL);
+
+	return 0;
+}
+
+unsigned test_eembed_memmem(void)
+{
+	test_eembed_memmem_func(eembed_memmem);
+	test_eembed_memmem_func(eembed_diy_memmem);
+	return 0;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_memmem)
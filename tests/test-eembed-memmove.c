@@ -14,6 +14,38 @@ static void test_byte_arrays(unsigned char *actual, size_t actual_len,
 	}
 }
 
+/* overlapping moves of every length up to several words, in each direction,
+ * by each distance up to a word and a bit, compared to a byte at a time */
+static void test_memmove_func_overlaps(void *(*memmove_func)(void *dest,
+							     const void *src,
+							     size_t n)
+    )
+{
+	unsigned char actual[100];
+	unsigned char expect[100];
+	size_t len, from, to, i;
+	void *rv;
+
+	for (from = 0; from < 20; ++from) {
+		for (to = 0; to < 20; ++to) {
+			for (len = 0; len <= 80; ++len) {
+				for (i = 0; i < 100; ++i) {
+					actual[i] = (unsigned char)(i + 1);
+					expect[i] = (unsigned char)(i + 1);
+				}
+				for (i = 0; i < len; ++i) {
+					expect[to + i] = (unsigned char)
+					    (from + i + 1);
+				}
+				rv = memmove_func(actual + to, actual + from,
+						  len);
+				eembed_crash_if_false(rv == actual + to);
+				test_byte_arrays(actual, 100, expect, 100);
+			}
+		}
+	}
+}
+
 unsigned test_eembed_memmove_func(void *(*memmove_func)(void *dest,
 							const void *src,
 							size_t n)
@@ -50,6 +82,8 @@ unsigned test_eembed_memmove_func(void *(*memmove_func)(void *dest,
 	test_byte_arrays(actual, 20, expect, 20);
 	eembed_crash_if_false(rv == (actual + 6));
 
+	test_memmove_func_overlaps(memmove_func);
+
 	return 0;
 }
 
@@ -15,6 +15,32 @@ static void fill_str(char *str, size_t len, char c, char term)
 	str[last] = term;
 }
 
+/* every length up to several words, at each alignment */
+static void test_memset_func_sizes(void *(*memset_func)(void *s, int c,
+							size_t n))
+{
+	unsigned char buf[96];
+	size_t len, off, i;
+	void *rv;
+
+	for (off = 0; off < 8; ++off) {
+		for (len = 0; len <= 80; ++len) {
+			for (i = 0; i < 96; ++i) {
+				buf[i] = 0x5A;
+			}
+			rv = memset_func(buf + off, 0xA5, len);
+			eembed_crash_if_false(rv == buf + off);
+			for (i = 0; i < 96; ++i) {
+				if (i < off || i >= (off + len)) {
+					eembed_crash_if_false(buf[i] == 0x5A);
+				} else {
+					eembed_crash_if_false(buf[i] == 0xA5);
+				}
+			}
+		}
+	}
+}
+
 unsigned test_eembed_memset_func(void *(*memset_func)(void *s, int c, size_t n))
 {
 	char expect[20];
@@ -37,6 +63,8 @@ unsigned test_eembed_memset_func(void *(*memset_func)(void *s, int c, size_t n))
 	eembed_crash_if_false(eembed_strcmp(actual, expect) == 0);
 	eembed_crash_if_false(rv == actual);
 
+	test_memset_func_sizes(memset_func);
+
 	return 0;
 }
 
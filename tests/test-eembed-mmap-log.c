@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+#if Eembed_use_mmap_log
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern void *(*eembed_mmap)(void *addr, size_t len, int prot, int flags,
+			    int fd, off_t offset);
+
+static void *test_mmap_fail(void *addr, size_t len, int prot, int flags,
+			    int fd, off_t offset)
+{
+	(void)addr;
+	(void)len;
+	(void)prot;
+	(void)flags;
+	(void)fd;
+	(void)offset;
+	return MAP_FAILED;
+}
+
+static size_t test_read_file(const char *path, char *buf, size_t size)
+{
+	int fd = open(path, O_RDONLY);
+	ssize_t len = 0;
+
+	if (fd < 0) {
+		return 0;
+	}
+	len = read(fd, buf, size - 1);
+	close(fd);
+	len = (len < 0) ? 0 : len;
+	buf[len] = '\0';
+	return (size_t)len;
+}
+
+unsigned int test_eembed_mmap_log(void)
+{
+	char path[80];
+	char actual[80];
+	struct eembed_mmap_log ctx;
+	struct eembed_log mlog;
+	struct eembed_log *log = NULL;
+	size_t len = 0;
+	unsigned failures = 0;
+
+	eembed_strcpy(path, "/tmp/test-eembed-mmap-log-");
+	len = eembed_strlen(path);
+	eembed_ulong_to_str(path + len, sizeof(path) - len, getpid());
+
+	failures += eembed_mmap_log_open(NULL, &ctx, path, 8) ? 1 : 0;
+	failures += eembed_mmap_log_open(&mlog, &ctx, "/no/such/dir/x", 8)
+	    ? 1 : 0;
+
+	eembed_mmap = test_mmap_fail;
+	failures += eembed_mmap_log_open(&mlog, &ctx, path, 8) ? 1 : 0;
+	eembed_mmap = mmap;
+
+	/* grows by 8 bytes at a time */
+	log = eembed_mmap_log_open(&mlog, &ctx, path, 8);
+	if (!log) {
+		return failures + 1;
+	}
+	log->append_s(log, "abc");
+	log->append_s(log, NULL);
+	log->append_c(log, ':');
+	log->append_ul(log, 12345);
+	log->append_fill(log, '-', 3);
+	log->append_n(log, "xyz", 2);
+	log->append_n(log, NULL, 2);
+	log->append_eol(log);
+	failures += (ctx.mapped == 16) ? 0 : 1;
+	failures += (fcntl(ctx.fd, F_GETFD) & FD_CLOEXEC) ? 0 : 1;
+
+	/* the hook, as at crash or exit, trims the file to the logged bytes */
+	eembed_flush_hooks_run();
+	failures += (ctx.map == NULL) ? 0 : 1;
+	failures += (lseek(ctx.fd, 0, SEEK_END) == 15) ? 0 : 1;
+	len = test_read_file(path, actual, sizeof(actual));
+	failures += (len == 15) ? 0 : 1;
+	failures += eembed_mmap_log_flush(&ctx) ? 1 : 0;
+
+	/* a failed re-map drops the bytes, the earlier bytes remain */
+	eembed_mmap = test_mmap_fail;
+	log->append_s(log, "lost, lost, lost");
+	eembed_mmap = mmap;
+	failures += (ctx.map == NULL) ? 0 : 1;
+	log->append_s(log, "ok");
+	log->append_eol(log);
+
+	failures += eembed_mmap_log_close(&ctx) ? 1 : 0;
+	failures += eembed_mmap_log_close(&ctx) ? 1 : 0;
+	failures += eembed_mmap_log_flush(&ctx) ? 1 : 0;
+
+	len = test_read_file(path, actual, sizeof(actual));
+	failures += (len == eembed_strlen(actual)) ? 0 : 1;
+	if (eembed_strcmp(actual, "abc:12345---xy\nok\n")) {
+		print_err_s("expected 'abc:12345---xy\\nok\\n' but was '");
+		print_err_s(actual);
+		print_err_s("'");
+		print_err_eol();
+		++failures;
+	}
+	unlink(path);
+
+	return failures;
+}
+#else
+unsigned int test_eembed_mmap_log(void)
+{
+	return 0;
+}
+#endif
+
+EEMBED_FUNC_MAIN(test_eembed_mmap_log)
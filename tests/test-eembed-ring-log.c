@@ -0,0 +1,187 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+#if EEMBED_HOSTED
+#include <unistd.h>
+#endif
+
+#if (Eembed_use_ring_log && defined(_POSIX_THREADS))
+#include <pthread.h>
+
+#define Test_threads 4
+#define Test_lines 2000
+
+struct test_sink {
+	unsigned long lines;
+	unsigned long garbled;
+	char last[Eembed_ring_log_line_size];
+};
+
+/* each line is the thread's letter, a colon, and then 40 more letters */
+static void test_sink_append_s(struct eembed_log *log, const char *str)
+{
+	struct test_sink *sink = (struct test_sink *)log->context;
+	size_t i = 0;
+
+	eembed_strcpy(sink->last, str);
+	if (eembed_strlen(str) != 42 || str[1] != ':') {
+		++sink->garbled;
+		return;
+	}
+	for (i = 2; i < 42; ++i) {
+		if (str[i] != str[0]) {
+			++sink->garbled;
+			return;
+		}
+	}
+}
+
+static void test_sink_append_eol(struct eembed_log *log)
+{
+	struct test_sink *sink = (struct test_sink *)log->context;
+	++sink->lines;
+}
+
+static struct eembed_log *test_ring_log = NULL;
+static unsigned test_producers_done = 0;
+
+static void *test_ring_log_thread(void *arg)
+{
+	char letters[11];
+	size_t i = 0;
+	size_t j = 0;
+
+	eembed_memset(letters, *((char *)arg), 10);
+	letters[10] = '\0';
+	for (i = 0; i < Test_lines; ++i) {
+		test_ring_log->append_c(test_ring_log, letters[0]);
+		test_ring_log->append_c(test_ring_log, ':');
+		for (j = 0; j < 4; ++j) {
+			test_ring_log->append_s(test_ring_log, letters);
+		}
+		test_ring_log->append_eol(test_ring_log);
+	}
+	__atomic_add_fetch(&test_producers_done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static unsigned test_ring_log_threads(void)
+{
+	struct eembed_ring_log_slot slots[64];
+	struct eembed_ring_log ring;
+	struct eembed_log rlog;
+	struct test_sink sink;
+	struct eembed_log slog;
+	pthread_t threads[Test_threads];
+	char ids[Test_threads];
+	size_t i = 0;
+	unsigned failures = 0;
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	slog = *eembed_null_log;
+	slog.context = &sink;
+	slog.append_s = test_sink_append_s;
+	slog.append_eol = test_sink_append_eol;
+
+	test_ring_log = eembed_ring_log_init(&rlog, &ring, slots, 64, &slog);
+
+	for (i = 0; i < Test_threads; ++i) {
+		ids[i] = 'A' + i;
+		pthread_create(&threads[i], NULL, test_ring_log_thread,
+			       &ids[i]);
+	}
+	while (__atomic_load_n(&test_producers_done, __ATOMIC_ACQUIRE)
+	       < Test_threads) {
+		eembed_ring_log_drain(&ring);
+	}
+	for (i = 0; i < Test_threads; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	eembed_ring_log_drain(&ring);
+
+	failures += (sink.garbled == 0) ? 0 : 1;
+	failures += (ring.truncated == 0) ? 0 : 1;
+	failures += ((sink.lines + ring.dropped) ==
+		     (Test_threads * Test_lines)) ? 0 : 1;
+	failures += (sink.lines > 0) ? 0 : 1;
+
+	return failures;
+}
+
+static unsigned test_ring_log_single(void)
+{
+	struct eembed_ring_log_slot slots[6];
+	struct eembed_ring_log ring;
+	struct eembed_ring_log other;
+	struct eembed_log rlog;
+	struct eembed_log olog;
+	struct eembed_log *log = NULL;
+	struct test_sink sink;
+	struct eembed_log slog;
+	char big[Eembed_ring_log_line_size + 10];
+	size_t i = 0;
+	unsigned failures = 0;
+
+	eembed_memset(&sink, 0x00, sizeof(sink));
+	slog = *eembed_null_log;
+	slog.context = &sink;
+	slog.append_s = test_sink_append_s;
+	slog.append_eol = test_sink_append_eol;
+
+	log = eembed_ring_log_init(&rlog, &ring, slots, 0, &slog);
+	failures += (log == NULL) ? 0 : 1;
+
+	/* six slots are rounded down to four */
+	log = eembed_ring_log_init(&rlog, &ring, slots, 6, &slog);
+	failures += (ring.mask == 3) ? 0 : 1;
+	for (i = 0; i < 5; ++i) {
+		log->append_ul(log, i);
+		log->append_eol(log);
+	}
+	failures += (ring.dropped == 1) ? 0 : 1;
+	failures += (eembed_ring_log_drain(&ring) == 4) ? 0 : 1;
+	failures += eembed_strcmp(sink.last, "3") ? 1 : 0;
+
+	/* a too long line is truncated */
+	eembed_memset(big, 'x', sizeof(big) - 1);
+	big[sizeof(big) - 1] = '\0';
+	log->append_s(log, big);
+	log->append_eol(log);
+	failures += (ring.truncated == 1) ? 0 : 1;
+
+	/* a partial line is pushed when the thread moves to another ring */
+	eembed_ring_log_init(&olog, &other, slots + 4, 2, &slog);
+	log->append_s(log, "partial");
+	olog.append_s(&olog, "other");
+	olog.append_eol(&olog);
+
+	/* drained by the flush hooks, as at a crash or exit */
+	eembed_flush_hook_add(&ring.flush_hook);
+	eembed_flush_hooks_run();
+	eembed_flush_hook_remove(&ring.flush_hook);
+	failures += eembed_strcmp(sink.last, "partial") ? 1 : 0;
+	failures += (eembed_ring_log_drain(&other) == 1) ? 0 : 1;
+	failures += eembed_strcmp(sink.last, "other") ? 1 : 0;
+
+	return failures;
+}
+
+unsigned int test_eembed_ring_log(void)
+{
+	unsigned failures = 0;
+
+	failures += test_ring_log_single();
+	failures += test_ring_log_threads();
+
+	return failures;
+}
+#else
+unsigned int test_eembed_ring_log(void)
+{
+	return 0;
+}
+#endif
+
+EEMBED_FUNC_MAIN(test_eembed_ring_log)
@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+/* a stub serial port which records the writes */
+struct test_serial {
+	char bytes[80];
+	size_t len;
+	unsigned writes;
+	size_t available;
+};
+
+static size_t test_serial_write(void *context, const char *bytes, size_t len)
+{
+	struct test_serial *ts = (struct test_serial *)context;
+
+	eembed_memcpy(ts->bytes + ts->len, bytes, len);
+	ts->len += len;
+	ts->bytes[ts->len] = '\0';
+	++ts->writes;
+	return len;
+}
+
+static size_t test_serial_available_for_write(void *context)
+{
+	return ((struct test_serial *)context)->available;
+}
+
+unsigned int test_eembed_serial_log(void)
+{
+	char buf[16];
+	struct test_serial ts;
+	struct eembed_serial serial = { NULL, test_serial_write, NULL };
+	struct eembed_serial_log ctx;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	unsigned failures = 0;
+
+	eembed_memset(&ts, 0x00, sizeof(ts));
+	serial.context = &ts;
+
+	failures += eembed_serial_log_init(&slog, NULL, buf, sizeof(buf),
+					   &serial, 0) ? 1 : 0;
+	/* non-blocking needs to know the room in the transmit buffer */
+	failures += eembed_serial_log_init(&slog, &ctx, buf, sizeof(buf),
+					   &serial, 1) ? 1 : 0;
+
+	/* a whole line is a single write */
+	log = eembed_serial_log_init(&slog, &ctx, buf, sizeof(buf), &serial,
+				     0);
+	log->append_s(log, "a=");
+	log->append_ul(log, 1);
+	log->append_c(log, ',');
+	log->append_s(log, " b=");
+	log->append_l(log, -2);
+	log->append_eol(log);
+	failures += (ts.writes == 1) ? 0 : 1;
+	failures += eembed_strcmp(ts.bytes, "a=1, b=-2\n") ? 1 : 0;
+
+	/* a non-blocking log drops a line which does not fit */
+	serial.available_for_write = test_serial_available_for_write;
+	log = eembed_serial_log_init(&slog, &ctx, buf, sizeof(buf), &serial,
+				     1);
+	ts.available = 4;
+	log->append_s(log, "ok");
+	log->append_eol(log);
+	log->append_s(log, "dropped");
+	log->append_eol(log);
+	failures += (ctx.dropped == 1) ? 0 : 1;
+	failures += (ts.writes == 2) ? 0 : 1;
+	failures += eembed_strcmp(ts.bytes, "a=1, b=-2\nok\n") ? 1 : 0;
+
+	/* a line longer than the buffer is written in pieces; once a piece
+	 * is dropped, the rest of the line is dropped, and counted once */
+	ts.available = 8;
+	log->append_s(log, "a line longer than the buffer");
+	log->append_eol(log);
+	log->append_s(log, "next");
+	log->append_eol(log);
+	failures += (ctx.dropped == 2) ? 0 : 1;
+	failures += (ts.writes == 3) ? 0 : 1;
+	failures += eembed_strcmp(ts.bytes, "a=1, b=-2\nok\nnext\n") ? 1 : 0;
+
+	if (failures) {
+		print_err_s("serial writes: '");
+		print_err_s(ts.bytes);
+		print_err_s("'");
+		print_err_eol();
+	}
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_serial_log)
@@ -0,0 +1,181 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* test-eembed-simd.c */
+/* Copyright (C) 2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+
+#if Eembed_use_diy_simd
+
+#define Buf_size 256
+
+static int sign_of(int i)
+{
+	return (i > 0) - (i < 0);
+}
+
+static void test_simd_memcmp(void)
+{
+	unsigned char a[Buf_size];
+	unsigned char b[Buf_size];
+	size_t len, pos, i;
+
+	for (i = 0; i < Buf_size; ++i) {
+		a[i] = (unsigned char)i;
+		b[i] = (unsigned char)i;
+	}
+	for (len = 0; len <= 100; ++len) {
+		eembed_crash_if_false(eembed_simd_memcmp(a + 3, b + 3, len)
+				      == 0);
+		for (pos = 0; pos < len; ++pos) {
+			b[3 + pos] = 0xFF;
+			eembed_crash_if_false(sign_of(eembed_simd_memcmp
+						      (a + 3, b + 3, len)) ==
+					      -1);
+			eembed_crash_if_false(sign_of(eembed_simd_memcmp
+						      (b + 3, a + 3, len)) ==
+					      1);
+			b[3 + pos] = a[3 + pos];
+		}
+	}
+}
+
+static void test_simd_memcpy_memset(void)
+{
+	unsigned char src[Buf_size];
+	unsigned char dest[Buf_size];
+	size_t len, off, i;
+	void *rv;
+
+	for (i = 0; i < Buf_size; ++i) {
+		src[i] = (unsigned char)(i + 1);
+	}
+	for (off = 0; off < 32; ++off) {
+		for (len = 0; len <= 100; ++len) {
+			eembed_diy_memset(dest, 0, Buf_size);
+			rv = eembed_simd_memcpy(dest + off, src + 1, len);
+			eembed_crash_if_false(rv == dest + off);
+			for (i = 0; i < Buf_size; ++i) {
+				if (i < off || i >= (off + len)) {
+					eembed_crash_if_false(dest[i] == 0);
+				} else {
+					eembed_crash_if_false(dest[i] ==
+							      src[(i + 1) -
+								  off]);
+				}
+			}
+
+			rv = eembed_simd_memset(dest + off, 0xA5, len);
+			eembed_crash_if_false(rv == dest + off);
+			for (i = 0; i < Buf_size; ++i) {
+				if (i >= off && i < (off + len)) {
+					eembed_crash_if_false(dest[i] == 0xA5);
+				}
+			}
+		}
+	}
+}
+
+static void test_simd_strlen(void)
+{
+	char buf[Buf_size];
+	size_t len, off;
+
+	eembed_diy_memset(buf, 'x', Buf_size);
+	for (off = 0; off < 64; ++off) {
+		for (len = 0; len <= 100; ++len) {
+			buf[off + len] = '\0';
+			eembed_crash_if_false(eembed_simd_strlen(buf + off)
+					      == len);
+			buf[off + len] = 'x';
+		}
+	}
+}
+
+/* needles placed at each position of haystacks of each length, and a near
+ * miss which matches the 'a' every fifth byte at both the first and the last
+ * bytes, but not in between */
+static void test_simd_strstr(void)
+{
+	const char *alphabet = "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGH";
+	char hay[Buf_size];
+	const char *miss = "aZZZZa";
+	char needle[48];
+	size_t hlen, nlen, pos, i;
+	char *found, *expect;
+
+	for (nlen = 0; nlen <= 40; nlen += 3) {
+		eembed_diy_memcpy(needle, alphabet, nlen);
+		needle[nlen] = '\0';
+		for (hlen = 0; hlen <= 120; ++hlen) {
+			for (pos = 0; pos <= hlen; ++pos) {
+				for (i = 0; i < hlen; ++i) {
+					hay[i] = (i % 5) ? '.' : 'a';
+				}
+				hay[hlen] = '\0';
+				if ((pos + nlen) <= hlen) {
+					eembed_diy_memcpy(hay + pos, needle,
+							  nlen);
+				}
+				found = eembed_simd_strstr(hay, needle);
+				expect = eembed_diy_strstr(hay, needle);
+				eembed_crash_if_false(found == expect);
+				found = eembed_simd_strstr(hay, miss);
+				eembed_crash_if_false(found == NULL);
+			}
+		}
+	}
+}
+
+/* a needle which matches at every position until its last byte; a check of
+ * each candidate in full would cost the haystack times the needle length */
+static void test_simd_strstr_adversarial(void)
+{
+	static char hay[8192 + 1];
+	static char needle[4096 + 1];
+	size_t hlen = sizeof(hay) - 1;
+	size_t nlen = sizeof(needle) - 1;
+	char *found;
+
+	eembed_diy_memset(hay, 'a', hlen);
+	hay[hlen] = '\0';
+	eembed_diy_memset(needle, 'a', nlen);
+	needle[nlen - 1] = 'b';
+	needle[nlen] = '\0';
+
+	found = eembed_simd_strstr(hay, needle);
+	eembed_crash_if_false(found == NULL);
+
+	hay[hlen - 1] = 'b';
+	found = eembed_simd_strstr(hay, needle);
+	eembed_crash_if_false(found == hay + (hlen - nlen));
+
+	found = eembed_simd_strstr(hay, "b");
+	eembed_crash_if_false(found == hay + (hlen - 1));
+	found = eembed_simd_strstr(hay, "c");
+	eembed_crash_if_false(found == NULL);
+}
+
+unsigned test_eembed_simd(void)
+{
+	enum eembed_simd_level level, selected;
+
+	for (level = eembed_simd_portable; level <= eembed_simd_avx2;
+	     level = (enum eembed_simd_level)(level + 1)) {
+		selected = eembed_simd_select(level);
+		eembed_crash_if_false(selected <= level);
+		test_simd_memcmp();
+		test_simd_memcpy_memset();
+		test_simd_strlen();
+		test_simd_strstr();
+		test_simd_strstr_adversarial();
+	}
+	return 0;
+}
+#else
+unsigned test_eembed_simd(void)
+{
+	return 0;
+}
+#endif
+
+EEMBED_FUNC_MAIN(test_eembed_simd)
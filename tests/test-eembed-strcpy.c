@@ -64,21 +64,75 @@ unsigned test_eembed_strcpy_func(char *(*strcpy_func)(char *dst,
 	eembed_crash_if_false(actual[2] == 'c');
 
 	/* strcpy_safe will always NULL terminate */
-	eembed_strcpy_safe(actual, 3, "abc");
+	eembed_crash_if_false(eembed_strcpy_safe(actual, 3, "abc") == 1);
 	eembed_crash_if_false(actual[2] == '\0');
 
+	/* and reports a string which fits */
+	eembed_crash_if_false(eembed_strcpy_safe(actual, 4, "abc") == 0);
+	eembed_crash_if_false(actual[2] == 'c');
+
 	/* and strcpy_safe will ignore NULL strings */
 	eembed_strcpy_safe(actual, 80, NULL);
 
 	return 0;
 }
 
+unsigned test_eembed_stpcpy_func(char *(*stpcpy_func)(char *dst,
+						      const char *src)
+    )
+{
+	char actual[80];
+	char *end = NULL;
+
+	fill_str(actual, 80, 'X');
+	end = stpcpy_func(actual, "foo");
+	eembed_crash_if_false(end == actual + 3);
+	end = stpcpy_func(end, "");
+	eembed_crash_if_false(end == actual + 3);
+	end = stpcpy_func(end, " bar");
+	eembed_crash_if_false(end == actual + 7);
+	eembed_crash_if_false(*end == '\0');
+	eembed_crash_if_false(eembed_strcmp(actual, "foo bar") == 0);
+
+	return 0;
+}
+
+unsigned test_eembed_strlcpy_func(size_t (*strlcpy_func)(char *dst,
+							 const char *src,
+							 size_t size)
+    )
+{
+	char actual[8];
+
+	fill_str(actual, 8, 'X');
+	eembed_crash_if_false(strlcpy_func(actual, "foo", 8) == 3);
+	eembed_crash_if_false(eembed_strcmp(actual, "foo") == 0);
+
+	/* truncated, but terminated, and the full length is reported */
+	eembed_crash_if_false(strlcpy_func(actual, "foo bar baz", 8) == 11);
+	eembed_crash_if_false(eembed_strcmp(actual, "foo bar") == 0);
+
+	/* exactly fits */
+	eembed_crash_if_false(strlcpy_func(actual, "1234567", 8) == 7);
+	eembed_crash_if_false(eembed_strcmp(actual, "1234567") == 0);
+
+	/* with no size, nothing is written, but the length is returned */
+	eembed_crash_if_false(strlcpy_func(actual, "abc", 0) == 3);
+	eembed_crash_if_false(eembed_strcmp(actual, "1234567") == 0);
+	eembed_crash_if_false(strlcpy_func(NULL, "abc", 0) == 3);
+
+	return 0;
+}
+
 unsigned test_eembed_strcpy(void)
 {
 	test_eembed_strcpy_func(eembed_strcpy, eembed_strncpy);
+	test_eembed_stpcpy_func(eembed_stpcpy);
 #if (EEMBED_HOSTED && (!(FAUX_FREESTANDING)))
 	test_eembed_strcpy_func(eembed_diy_strcpy, eembed_diy_strncpy);
+	test_eembed_stpcpy_func(eembed_diy_stpcpy);
 #endif
+	test_eembed_strlcpy_func(eembed_strlcpy);
 	return 0;
 }
 
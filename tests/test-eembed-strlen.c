@@ -4,6 +4,32 @@
 
 #include "eembed.h"
 
+/* every length up to several words, at each alignment, with and without
+ * a terminating NULL within the limit */
+static void test_strlen_func_sizes(size_t (*strlen_func)(const char *s),
+				   size_t (*strnlen_func)(const char *s,
+							  size_t max)
+    )
+{
+	char buf[96];
+	size_t len, off, max, i;
+
+	for (off = 0; off < 8; ++off) {
+		for (len = 0; len <= 80; ++len) {
+			for (i = 0; i < 96; ++i) {
+				buf[i] = (char)(0x80 + i);
+			}
+			buf[off + len] = '\0';
+			eembed_crash_if_false(strlen_func(buf + off) == len);
+			for (max = 0; max <= 88 - off; max += 3) {
+				eembed_crash_if_false(strnlen_func(buf + off,
+								   max) ==
+						      (max < len ? max : len));
+			}
+		}
+	}
+}
+
 unsigned test_eembed_strlen_func(size_t (*strlen_func)(const char *s),
 				 size_t (*strnlen_func)(const char *s,
 							size_t max)
@@ -21,6 +47,8 @@ unsigned test_eembed_strlen_func(size_t (*strlen_func)(const char *s),
 	eembed_crash_if_false(strnlen_func("123456789", 10) == 9);
 	eembed_crash_if_false(strnlen_func("123456789", 4) == 4);
 
+	test_strlen_func_sizes(strlen_func, strnlen_func);
+
 	return 0;
 }
 
@@ -4,6 +4,82 @@
 
 #include "eembed.h"
 
+static const char *naive_strstr(const char *haystack, const char *needle)
+{
+	size_t i, j;
+
+	for (i = 0; haystack[i]; ++i) {
+		for (j = 0; needle[j] && haystack[i + j] == needle[j]; ++j) {
+			;
+		}
+		if (!needle[j]) {
+			return haystack + i;
+		}
+	}
+	return needle[0] ? NULL : haystack;
+}
+
+/* fills the string with the bits of the pattern as 'a' and 'b' */
+static void ab_str(char *str, size_t len, unsigned pattern)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		str[i] = (pattern & (1U << i)) ? 'b' : 'a';
+	}
+	str[len] = '\0';
+}
+
+/* every needle up to 6 bytes of 'a' and 'b', which includes periodic and
+ * non-periodic needles, within every haystack up to 10 bytes */
+static void test_strstr_func_ab(char *(*strstr_func)(const char *haystack,
+						     const char *needle)
+    )
+{
+	char haystack[16];
+	char needle[8];
+	size_t hlen, nlen;
+	unsigned hpat, npat;
+	const char *expect;
+	char *rv;
+
+	for (nlen = 1; nlen <= 6; ++nlen) {
+		for (npat = 0; npat < (1U << nlen); ++npat) {
+			ab_str(needle, nlen, npat);
+			for (hlen = 0; hlen <= 10; ++hlen) {
+				for (hpat = 0; hpat < (1U << hlen); ++hpat) {
+					ab_str(haystack, hlen, hpat);
+					rv = strstr_func(haystack, needle);
+					expect = naive_strstr(haystack, needle);
+					eembed_crash_if_false(rv == expect);
+				}
+			}
+		}
+	}
+}
+
+/* a long haystack, measured only as far as the search needs */
+static void test_strstr_func_long(char *(*strstr_func)(const char *haystack,
+						       const char *needle)
+    )
+{
+	char haystack[1024];
+	const char *needle = "needle in the haystack";
+	size_t i;
+	char *rv;
+
+	for (i = 0; i < (sizeof(haystack) - 1); ++i) {
+		haystack[i] = (char)('a' + (i % 26));
+	}
+	haystack[sizeof(haystack) - 1] = '\0';
+	rv = strstr_func(haystack, needle);
+	eembed_crash_if_false(rv == NULL);
+
+	eembed_memcpy(haystack + 700, needle, eembed_strlen(needle));
+	rv = strstr_func(haystack, needle);
+	eembed_crash_if_false(rv == haystack + 700);
+}
+
 unsigned test_eembed_strstr_func(char *(*strstr_func)(const char *haystack,
 						      const char *needle)
     )
@@ -34,6 +110,9 @@ unsigned test_eembed_strstr_func(char *(*strstr_func)(const char *haystack,
 	expect = NULL;
 	eembed_crash_if_false(rv == expect);
 
+	test_strstr_func_ab(strstr_func);
+	test_strstr_func_long(strstr_func);
+
 	return 0;
 }
 
@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+/* the debug logging is wanted even with NDEBUG */
+#define Eembed_log_level_max eembed_log_level_trace
+#include "eembed.h"
+#include "test-eembed-log-util.h"
+
+#if Eembed_use_async_log
+/* a statement on another thread, while a debug statement is running */
+static void *test_other_thread(void *arg)
+{
+	unsigned char *seen = (unsigned char *)arg;
+
+	seen[0] = eembed_log_message_level;
+	eembed_error(seen[1] = eembed_log_message_level);
+	return NULL;
+}
+
+/* runs the other thread to completion, returns the level seen by this one */
+static unsigned char test_run_other_thread(unsigned char *seen)
+{
+	pthread_t thread;
+
+	if (pthread_create(&thread, NULL, test_other_thread, seen) == 0) {
+		pthread_join(thread, NULL);
+	}
+	return eembed_log_message_level;
+}
+
+static unsigned test_message_level_per_thread(void)
+{
+	unsigned char seen[2] = { 0xFF, 0xFF };
+	unsigned char mine = 0;
+	unsigned failures = 0;
+
+	eembed_debug(mine = test_run_other_thread(seen));
+
+	failures += (mine == eembed_log_level_debug) ? 0 : 1;
+	failures += (seen[0] == 0) ? 0 : 1;
+	failures += (seen[1] == eembed_log_level_error) ? 0 : 1;
+	failures += (eembed_log_message_level == 0) ? 0 : 1;
+	return failures;
+}
+#else
+static unsigned test_message_level_per_thread(void)
+{
+	return 0;
+}
+#endif
+
+unsigned int test_eembed_tee_log(void)
+{
+	char info_buf[80];
+	char debug_buf[80];
+	struct eembed_str_buf info_ctx;
+	struct eembed_str_buf debug_ctx;
+	struct eembed_log info_log;
+	struct eembed_log debug_log;
+	struct eembed_tee_log_sink sinks[2];
+	struct eembed_tee_log ctx;
+	struct eembed_log tlog;
+	struct eembed_log *log = NULL;
+	unsigned char orig_level = eembed_log_level;
+	unsigned failures = 0;
+
+	failures += eembed_tee_log_init(NULL, &ctx, sinks, 2) ? 1 : 0;
+	failures += eembed_tee_log_init(&tlog, NULL, sinks, 2) ? 1 : 0;
+
+	/* no sinks, nothing to do */
+	log = eembed_tee_log_init(&tlog, &ctx, NULL, 2);
+	failures += (ctx.sinks_len == 0) ? 0 : 1;
+	log->append_s(log, "nowhere");
+	log->append_eol(log);
+
+	info_buf[0] = '\0';
+	debug_buf[0] = '\0';
+	sinks[0].log = eembed_char_buf_log_init(&info_log, &info_ctx,
+						info_buf, sizeof(info_buf));
+	sinks[0].level = eembed_log_level_info;
+	sinks[1].log = eembed_char_buf_log_init(&debug_log, &debug_ctx,
+						debug_buf, sizeof(debug_buf));
+	sinks[1].level = eembed_log_level_debug;
+	log = eembed_tee_log_init(&tlog, &ctx, sinks, 2);
+
+	eembed_log_level = eembed_log_level_trace;
+
+	log->append_s(log, "a");
+	log->append_s(log, NULL);
+	log->append_c(log, ':');
+	log->append_ul(log, 12);
+	log->append_fill(log, '.', 2);
+	log->append_eol(log);
+	eembed_info(log->append_s(log, "i"); log->append_l(log, -3);
+		    log->append_eol(log));
+	eembed_debug(log->append_s(log, "d"); log->append_fill(log, '+', 2);
+		     log->append_ul(log, 7); log->append_eol(log));
+	eembed_trace(log->append_s(log, "t"); log->append_eol(log));
+	log->append_n(log, "zz", 1);
+
+	failures += check_str("info", "a:12..\ni-3\nz", info_buf);
+	failures += check_str("debug", "a:12..\ni-3\nd++7\nz", debug_buf);
+	failures += (eembed_log_message_level == 0) ? 0 : 1;
+	failures += test_message_level_per_thread();
+
+	eembed_log_level = orig_level;
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_tee_log)
@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "eembed.h"
+#include "test-eembed-log-util.h"
+
+static uint64_t fake_now = 0;
+static unsigned fake_now_calls = 0;
+
+static uint64_t fake_now_ns(void)
+{
+	++fake_now_calls;
+	return fake_now;
+}
+
+static unsigned test_uptime(void)
+{
+	uint64_t ms = 0;
+	uint64_t ns = 0;
+	uint64_t coarse = 0;
+	unsigned failures = 0;
+
+	ms = eembed_hosted_uptime_ms();
+	ns = eembed_hosted_uptime_ns();
+	coarse = eembed_hosted_uptime_ns_coarse();
+	failures += (ns >= (ms * 1000 * 1000)) ? 0 : 1;
+	failures += (coarse > 0) ? 0 : 1;
+	failures += (eembed_hosted_uptime_ns() >= ns) ? 0 : 1;
+
+	return failures;
+}
+
+unsigned int test_eembed_timestamp_log(void)
+{
+	char buf[200];
+	struct eembed_str_buf sctx;
+	struct eembed_log slog;
+	struct eembed_log *sink = NULL;
+	struct eembed_timestamp_log ctx;
+	struct eembed_log tlog;
+	struct eembed_log *log = NULL;
+	char *found = NULL;
+	unsigned failures = 0;
+
+	failures += test_uptime();
+
+	buf[0] = '\0';
+	sink = eembed_char_buf_log_init(&slog, &sctx, buf, sizeof(buf));
+
+	failures += eembed_timestamp_log_init(NULL, &ctx, NULL, sink) ? 1 : 0;
+	failures += eembed_timestamp_log_init(&tlog, &ctx, NULL, NULL) ? 1 : 0;
+
+	log = eembed_timestamp_log_init(&tlog, &ctx, fake_now_ns, sink);
+	fake_now = (((uint64_t)12) * 1000 * 1000 * 1000) + 345678;
+	log->append_s(log, "a");
+	log->append_c(log, '=');
+	log->append_ul(log, 1);
+	log->append_n(log, " b", 2);
+	log->append_fill(log, '=', 1);
+	log->append_l(log, -2);
+	log->append_eol(log);
+	fake_now = 5;
+	log->append_eol(log);
+	failures += check_str("stamps", "12.000345678 a=1 b=-2\n"
+			      "0.000000005 \n", buf);
+	failures += (fake_now_calls == 2) ? 0 : 1;
+
+	/* the default clock */
+	eembed_str_buf_reset(&sctx);
+	log = eembed_timestamp_log_init(&tlog, &ctx, NULL, sink);
+	log->append_f(log, 0.5);
+	log->append_fd(log, 0.5, 1);
+	log->append_vp(log, NULL);
+	log->append_eol(log);
+	failures += (ctx.now_ns == eembed_hosted_uptime_ns) ? 0 : 1;
+	/* nine digits after the point */
+	found = eembed_strstr(buf, ".");
+	failures += (found && found[10] == ' ') ? 0 : 1;
+
+	return failures;
+}
+
+EEMBED_FUNC_MAIN(test_eembed_timestamp_log)
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* libecheck: "E(asy)Check" boiler-plate to make simple testing easier */
+/* Copyright (C) 2016-2025 Eric Herman <eric@freesa.org> */
+
+#include "echeck.h"
+
+unsigned test_check_alloc_budget(void)
+{
+	unsigned failures = 0;
+	const size_t bytes_len = 100 * sizeof(size_t);
+	unsigned char bytes[100 * sizeof(size_t)];
+	const size_t mem_buf_len = 1024;
+	char mem_buf[1024];
+	struct eembed_str_buf log_ctx;
+	struct eembed_log buf_log;
+	struct eembed_log *log = NULL;
+	struct eembed_allocator with_errs;
+	struct echeck_err_injecting_context mctx;
+	struct eembed_allocator *real = NULL;
+	struct eembed_allocator *orig = eembed_global_allocator;
+	void *p[2];
+	const char *strs[3];
+
+	if (!EEMBED_HOSTED || eembed_global_allocator == NULL) {
+		real = eembed_bytes_allocator(bytes, bytes_len);
+	} else {
+		real = eembed_global_allocator;
+	}
+
+	eembed_memset(mem_buf, 0x00, mem_buf_len);
+	log = eembed_char_buf_log_init(&buf_log, &log_ctx, mem_buf,
+				       mem_buf_len);
+
+	echeck_err_injecting_allocator_init(&with_errs, real, &mctx, log);
+	eembed_global_allocator = &with_errs;
+	p[0] = eembed_malloc(10);
+	p[1] = eembed_malloc(20);
+	eembed_free(p[0]);
+	eembed_free(p[1]);
+	eembed_global_allocator = orig;
+
+	failures += check_allocs_at_most(&mctx, 2);
+	failures += check_alloc_bytes_at_most(&mctx, 30);
+	failures += check_max_used_at_most(&mctx, 30);
+	failures += check_max_used_at_most_m(&mctx, 100, "roomy");
+	failures += check_str(mem_buf, "");
+
+	if (0 == lcheck_allocs_at_most(log, &mctx, 1)) {
+		failures++;
+	}
+	strs[0] = "allocs at most 1";
+	strs[1] = "but was 2";
+	strs[2] = "&mctx";
+	failures += check_str_contains_all(mem_buf, strs, 3);
+
+	eembed_memset(mem_buf, 0x00, mem_buf_len);
+	if (0 == lcheck_alloc_bytes_at_most_m(log, &mctx, 29, "hot path")) {
+		failures++;
+	}
+	strs[0] = "FAIL: hot path:";
+	strs[1] = "alloc_bytes at most 29";
+	strs[2] = "but was 30";
+	failures += check_str_contains_all(mem_buf, strs, 3);
+
+	eembed_memset(mem_buf, 0x00, mem_buf_len);
+	if (0 == lcheck_max_used_at_most(log, &mctx, 0)) {
+		failures++;
+	}
+	strs[0] = "max_used at most 0";
+	strs[1] = "but was 30";
+	strs[2] = "test_check_alloc_budget.c";
+	failures += check_str_contains_all(mem_buf, strs, 3);
+
+	return failures;
+}
+
+ECHECK_TEST_MAIN(test_check_alloc_budget)
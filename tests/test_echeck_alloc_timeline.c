@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "echeck.h"
+
+unsigned test_echeck_alloc_timeline(void)
+{
+	unsigned failures = 0;
+	const size_t bytes_len = 250 * sizeof(size_t);
+	unsigned char bytes[250 * sizeof(size_t)];
+	const size_t buf_size = 250;
+	char buf[250];
+	struct eembed_str_buf sbuf;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	struct eembed_allocator with_errs;
+	struct echeck_err_injecting_context mctx;
+	struct echeck_err_injecting_sample samples[4];
+	struct eembed_allocator *real = NULL;
+	struct eembed_allocator *orig = eembed_global_allocator;
+	void *p[8];
+	size_t i = 0;
+	const char *expected = NULL;
+
+	if (!EEMBED_HOSTED || eembed_global_allocator == NULL) {
+		real = eembed_bytes_allocator(bytes, bytes_len);
+	} else {
+		real = eembed_global_allocator;
+	}
+
+	eembed_memset(buf, 0x00, buf_size);
+	log = eembed_char_buf_log_init(&slog, &sbuf, buf, buf_size);
+
+	echeck_err_injecting_allocator_init(&with_errs, real, &mctx, log);
+	echeck_err_injecting_timeline_init(&mctx, samples, 4, 2);
+	eembed_global_allocator = &with_errs;
+
+	/* granularity 2: attempts 1 | 2, 3 | 4, 5 | 6, 7 | 8 */
+	p[0] = eembed_malloc(10);
+	p[1] = eembed_malloc(20);
+	eembed_free(p[0]);
+	p[2] = eembed_malloc(5);
+	p[3] = eembed_malloc(100);
+	eembed_free(p[1]);
+	eembed_free(p[2]);
+	eembed_free(p[3]);
+	p[4] = eembed_malloc(1);
+	p[5] = eembed_malloc(2);
+	p[6] = eembed_malloc(3);
+	p[7] = eembed_malloc(4);
+	for (i = 4; i < 8; ++i) {
+		eembed_free(p[i]);
+	}
+
+	eembed_global_allocator = orig;
+
+	failures += check_size_t(mctx.timeline_count, 5);
+	failures += check_unsigned_long(mctx.max_used, 125);
+
+	echeck_err_injecting_timeline_csv(log, &mctx);
+	/* the first sample {1,10} has been overwritten */
+	expected = "attempts,used\n2,30\n4,125\n7,6\n8,10\n";
+	failures += check_str(buf, expected);
+
+	eembed_memset(buf, 0x00, buf_size);
+	echeck_err_injecting_timeline_init(&mctx, NULL, 4, 0);
+	failures += check_unsigned_long(mctx.timeline_granularity, 1);
+	echeck_err_injecting_timeline_csv(log, &mctx);
+	failures += check_str(buf, "attempts,used\n");
+
+	return failures;
+}
+
+ECHECK_TEST_MAIN(test_echeck_alloc_timeline)
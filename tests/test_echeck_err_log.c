@@ -4,35 +4,11 @@
 
 #include "echeck.h"
 
-void eembed_no_op_append_s(struct eembed_log *log, const char *str);
-
 #if EEMBED_HOSTED
 
 #include <stdio.h>
 /* _POSIX_C_SOURCE >= 200809L || _GNU_SOURCE */
 FILE *fmemopen(void *buf, size_t size, const char *mode);
-#else
-void eembed_test_hosted_buf_append_s(struct eembed_log *log, const char *str)
-{
-	struct eembed_str_buf *sbuf = NULL;
-	size_t slen = 0;
-	size_t used = 0;
-	size_t left = 0;
-
-	(void)log;
-
-	if (eembed_err_log) {
-		sbuf = (struct eembed_str_buf *)eembed_err_log->context;
-	}
-	if (sbuf) {
-		used = eembed_strnlen(sbuf->buf, sbuf->size);
-		left = sbuf->size - used;
-		slen = eembed_strlen(str);
-		if (slen < left) {
-			eembed_strcat(sbuf->buf, str);
-		}
-	}
-}
 #endif
 
 #if EEMBED_HOSTED
@@ -51,6 +27,7 @@ unsigned test_echeck_err_log(void)
 	struct eembed_function_context mem_context = { NULL, eembed_test_func };
 #else
 	struct eembed_str_buf sbuf;
+	struct eembed_log orig_log;
 #endif
 	void *orig = NULL;
 	unsigned failures = 0;
@@ -78,10 +55,9 @@ unsigned test_echeck_err_log(void)
 	mem_context.data = memlogfile;
 	eembed_err_log->context = &mem_context;
 #else
-	eembed_err_log->append_s = eembed_test_hosted_buf_append_s;
-	sbuf.buf = logbuf;
-	sbuf.size = logbuf_size;
-	eembed_err_log->context = &sbuf;
+	/* the whole log is replaced, as the appends share the context */
+	orig_log = *eembed_err_log;
+	eembed_char_buf_log_init(eembed_err_log, &sbuf, logbuf, logbuf_size);
 #endif
 
 	if (0 == check_ptr(logbuf, orig)) {
@@ -104,7 +80,7 @@ unsigned test_echeck_err_log(void)
 	fclose(memlogfile);
 	memlogfile = NULL;
 #else
-	eembed_err_log->append_s = eembed_no_op_append_s;
+	*eembed_err_log = orig_log;
 #endif
 
 	failures += check_str_contains(logbuf, "logbuf");
@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "echeck.h"
+
+static unsigned long last_delay = 0;
+static unsigned long delay_calls = 0;
+
+static void test_delay(unsigned long amount)
+{
+	last_delay = amount;
+	++delay_calls;
+}
+
+static unsigned long tail_ones = 0;
+static unsigned long tail_capped = 0;
+static unsigned long tail_over = 0;
+
+static void test_tail_delay(unsigned long amount)
+{
+	tail_ones += (amount == 1) ? 1 : 0;
+	tail_capped += (amount == 8) ? 1 : 0;
+	tail_over += (amount > 8) ? 1 : 0;
+	test_delay(amount);
+}
+
+static unsigned test_latency_uniform(struct echeck_latency_injecting_context
+				     *ctx)
+{
+	unsigned failures = 0;
+	unsigned seen[3] = { 0, 0, 0 };
+	size_t i = 0;
+	void *ptr = NULL;
+
+	ctx->distribution = echeck_latency_uniform;
+	ctx->delay_min = 3;
+	ctx->delay_max = 5;
+	for (i = 0; i < 100; ++i) {
+		ptr = eembed_malloc(10);
+		failures += check_int(last_delay >= 3 && last_delay <= 5, 1);
+		++seen[(last_delay - 3) % 3];
+		eembed_free(ptr);
+	}
+	failures += check_int(seen[0] > 0, 1);
+	failures += check_int(seen[1] > 0, 1);
+	failures += check_int(seen[2] > 0, 1);
+
+	/* a full-width span must not divide by zero */
+	ctx->delay_min = 0;
+	ctx->delay_max = ULONG_MAX;
+	ptr = eembed_calloc(2, 5);
+	eembed_free(ptr);
+
+	/* an inverted range collapses to delay_min */
+	ctx->delay_min = 4;
+	ctx->delay_max = 1;
+	ptr = eembed_malloc(10);
+	failures += check_unsigned_long(last_delay, 4);
+	eembed_free(ptr);
+
+	return failures;
+}
+
+static unsigned test_latency_heavy_tail(struct echeck_latency_injecting_context
+					*ctx)
+{
+	unsigned failures = 0;
+	unsigned long ones = 0;
+	unsigned long capped = 0;
+	unsigned long first_total = 0;
+	size_t i = 0;
+	void *ptr = NULL;
+
+	ctx->distribution = echeck_latency_heavy_tail;
+	ctx->delay_min = 1;
+	ctx->delay_max = 48;
+	ctx->seed = 42;
+	ctx->delayed_total = 0;
+	for (i = 0; i < 1000; ++i) {
+		ptr = eembed_malloc(10);
+		eembed_free(ptr);
+		if (last_delay == 1) {
+			++ones;
+		}
+		if (last_delay == 48) {
+			++capped;
+		}
+		failures += check_int(last_delay <= 48, 1);
+	}
+	/* roughly half should be the minimum, a few should hit the cap */
+	failures += check_int(ones > 400 && ones < 600, 1);
+	failures += check_int(capped > 0 && capped < 200, 1);
+
+	/* the same seed reproduces the same delays */
+	first_total = ctx->delayed_total;
+	ctx->seed = 42;
+	ctx->delayed_total = 0;
+	for (i = 0; i < 1000; ++i) {
+		ptr = eembed_malloc(10);
+		eembed_free(ptr);
+	}
+	failures += check_unsigned_long(ctx->delayed_total, first_total);
+
+	/* a zero minimum still has a tail: of 2000 amounts, about half are
+	 * zero (and are not passed to the delay), a quarter are one */
+	ctx->delay = test_tail_delay;
+	ctx->delay_min = 0;
+	ctx->delay_max = 8;
+	delay_calls = 0;
+	for (i = 0; i < 1000; ++i) {
+		ptr = eembed_malloc(10);
+		eembed_free(ptr);
+	}
+	ctx->delay = test_delay;
+	failures += check_int(delay_calls > 800 && delay_calls < 1200, 1);
+	failures += check_int(tail_ones > 350 && tail_ones < 650, 1);
+	failures += check_int(tail_capped > 0 && tail_capped < 250, 1);
+	failures += check_unsigned_long(tail_over, 0);
+
+	return failures;
+}
+
+unsigned test_echeck_latency_alloc(void)
+{
+	unsigned failures = 0;
+	const size_t bytes_len = 100 * sizeof(size_t);
+	unsigned char bytes[100 * sizeof(size_t)];
+	struct eembed_allocator slow;
+	struct echeck_latency_injecting_context ctx;
+	struct eembed_allocator *real = NULL;
+	struct eembed_allocator *orig = eembed_global_allocator;
+	char *str = NULL;
+
+	if (!EEMBED_HOSTED || eembed_global_allocator == NULL) {
+		real = eembed_bytes_allocator(bytes, bytes_len);
+	} else {
+		real = eembed_global_allocator;
+	}
+
+	echeck_latency_injecting_allocator_init(&slow, real, &ctx);
+	failures += check_int(ctx.delay != NULL, 1);
+#ifdef delay_ms_u16
+	/* the default delay actually sleeps */
+	ctx.delay_min = 1;
+	eembed_global_allocator = &slow;
+	str = (char *)eembed_malloc(4);
+	eembed_global_allocator = orig;
+	failures += check_unsigned_long(ctx.delayed_total, 1);
+	ctx.delay_min = 0;
+	ctx.delayed_total = 0;
+#endif
+	ctx.delay = test_delay;
+	eembed_global_allocator = &slow;
+
+	ctx.delay_min = 7;
+	ctx.delay_max = 100;
+	str = (char *)eembed_realloc(str, 8);
+	failures += check_unsigned_long(last_delay, 7);
+	str = (char *)eembed_reallocarray(str, 2, 8);
+	eembed_free(str);
+	failures += check_unsigned_long(delay_calls, 3);
+
+	failures += test_latency_uniform(&ctx);
+	failures += test_latency_heavy_tail(&ctx);
+
+	/* no delay function call for a zero delay */
+	delay_calls = 0;
+	ctx.distribution = echeck_latency_fixed;
+	ctx.delay_min = 0;
+	ctx.delays = 0;
+	str = (char *)eembed_malloc(4);
+	eembed_free(str);
+	failures += check_unsigned_long(ctx.delays, 2);
+	failures += check_unsigned_long(delay_calls, 0);
+
+	eembed_global_allocator = orig;
+
+	echeck_latency_spin(1000);
+	echeck_latency_spin_ms(2);
+
+	return failures;
+}
+
+ECHECK_TEST_MAIN(test_echeck_latency_alloc)
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "echeck.h"
+
+static size_t sum_no_alloc(const unsigned char *bytes, size_t len)
+{
+	size_t i = 0;
+	size_t sum = 0;
+
+	for (i = 0; i < len; ++i) {
+		sum += bytes[i];
+	}
+	return sum;
+}
+
+unsigned test_echeck_no_alloc(void)
+{
+	unsigned failures = 0;
+	const size_t bytes_len = 100 * sizeof(size_t);
+	unsigned char bytes[100 * sizeof(size_t)];
+	const size_t mem_buf_len = 1024;
+	char mem_buf[1024];
+	struct eembed_str_buf log_ctx;
+	struct eembed_log buf_log;
+	struct eembed_log *log = NULL;
+	struct eembed_allocator *orig = eembed_global_allocator;
+	unsigned char ones[10];
+	unsigned char *p = NULL;
+	const char *strs[3];
+	char expect[200];
+	long line = 0;
+
+	if (!EEMBED_HOSTED) {
+		eembed_global_allocator =
+		    eembed_bytes_allocator(bytes, bytes_len);
+	}
+
+	eembed_memset(ones, 0x01, 10);
+	echeck_no_alloc_begin();
+	failures += check_size_t(sum_no_alloc(ones, 10), 10);
+	failures += check_unsigned_long(echeck_no_alloc_end(), 0);
+
+	eembed_memset(mem_buf, 0x00, mem_buf_len);
+	log = eembed_char_buf_log_init(&buf_log, &log_ctx, mem_buf,
+				       mem_buf_len);
+	echeck_no_alloc_begin_l(log);
+	p = (unsigned char *)eembed_malloc(10);
+	p = (unsigned char *)eembed_realloc(p, 20);
+	p = (unsigned char *)eembed_reallocarray(p, 3, 10);
+	eembed_free(p);
+	p = (unsigned char *)eembed_calloc(2, 4);
+	eembed_free(p);
+	failures += check_unsigned_long(echeck_no_alloc_end(), 4);
+
+	strs[0] = "FAIL: no_alloc: unexpected eembed_malloc(10)";
+	strs[1] = "eembed_reallocarray(30)";
+	strs[2] = "test_echeck_no_alloc.c";
+	failures += check_str_contains_all(mem_buf, strs, 3);
+	strs[0] = "eembed_realloc(20)";
+	strs[1] = "eembed_calloc(8)";
+	failures += check_str_contains_all(mem_buf, strs, 2);
+
+	/* the site of the allocation is reported, when known */
+	eembed_memset(mem_buf, 0x00, mem_buf_len);
+	eembed_str_buf_reset(&log_ctx);
+	echeck_no_alloc_begin_l(log);
+	p = (unsigned char *)eembed_malloc_at(12);
+	line = __LINE__ - 1;
+	eembed_free(p);
+	failures += check_unsigned_long(echeck_no_alloc_end(), 1);
+	eembed_strcpy(expect, "eembed_malloc(12) at ");
+	eembed_strcat(expect, __FILE__);
+	eembed_strcat(expect, ":");
+	eembed_long_to_str(expect + eembed_strlen(expect),
+			   sizeof(expect) - eembed_strlen(expect), line);
+	eembed_strcat(expect, " ");
+	failures += check_str_contains(mem_buf, expect);
+#if __GNUC__
+	failures += check_str_contains(mem_buf, " called from ");
+#endif
+	failures += check_ptr(eembed_alloc_site.file, NULL);
+
+	eembed_global_allocator = orig;
+
+	return failures;
+}
+
+ECHECK_TEST_MAIN(test_echeck_no_alloc)
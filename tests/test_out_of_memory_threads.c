@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2020-2025 Eric Herman <eric@freesa.org> */
+
+#include "echeck.h"
+
+#if EEMBED_HOSTED
+#include <unistd.h>
+#endif
+
+#if (EEMBED_HOSTED && defined(_POSIX_THREADS) && Echeck_use_atomic_counters)
+#include <pthread.h>
+
+#define Test_threads 4
+#define Test_loops 2000
+
+void *test_out_of_memory_thread(void *arg)
+{
+	size_t id = *((size_t *)arg);
+	char *ptrs[8];
+	size_t i = 0;
+	size_t j = 0;
+	size_t size = 0;
+
+	for (i = 0; i < Test_loops; ++i) {
+		j = i % 8;
+		size = 1 + ((i + id) % 53);
+		ptrs[j] = (char *)eembed_malloc(size);
+		if (ptrs[j]) {
+			eembed_memset(ptrs[j], 'A' + id, size);
+		}
+		if (j == 7) {
+			for (j = 0; j < 8; ++j) {
+				eembed_free(ptrs[j]);
+				ptrs[j] = NULL;
+			}
+		}
+	}
+	return NULL;
+}
+
+/* runs the threads with the given failures injected; as the attempts are
+ * counted atomically, exactly one attempt fails for each bit of the mask,
+ * whichever thread makes it, and each such NULL is later freed */
+static unsigned test_threads_with_mask(unsigned long mask, unsigned long fail)
+{
+	unsigned failures = 0;
+	const size_t buf_size = 250;
+	char buf[250];
+	struct eembed_str_buf sbuf;
+	struct eembed_log slog;
+	struct eembed_log *log = NULL;
+	struct eembed_allocator with_errs;
+	struct echeck_err_injecting_context mctx;
+	struct eembed_allocator *orig = eembed_global_allocator;
+	pthread_t threads[Test_threads];
+	size_t ids[Test_threads];
+	size_t i = 0;
+	size_t started = 0;
+	const unsigned long total = Test_threads * Test_loops;
+
+	eembed_memset(buf, 0x00, buf_size);
+	log = eembed_char_buf_log_init(&slog, &sbuf, buf, buf_size);
+
+	echeck_err_injecting_allocator_init(&with_errs, orig, &mctx, log);
+	mctx.attempts_to_fail_bitmask = mask;
+	eembed_global_allocator = &with_errs;
+
+	for (i = 0; i < Test_threads; ++i) {
+		ids[i] = i;
+		if (pthread_create(&threads[i], NULL,
+				   test_out_of_memory_thread, &ids[i]) == 0) {
+			++started;
+		}
+	}
+	failures += check_unsigned_long(started, Test_threads);
+	for (i = 0; i < started; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	eembed_global_allocator = orig;
+
+	failures += check_unsigned_long(mctx.attempts, started * Test_loops);
+	failures += check_unsigned_long(mctx.allocs, total - fail);
+	failures += check_unsigned_long(mctx.frees, mctx.allocs);
+	failures += check_unsigned_long(mctx.free_bytes, mctx.alloc_bytes);
+	failures += check_unsigned_long(mctx.fails, fail);
+	failures += check_int(mctx.max_used > 0, 1);
+	failures += check_int(mctx.max_used <= (Test_threads * 8 * 53), 1);
+	failures += check_str(buf, "");
+
+	return failures;
+}
+
+unsigned test_out_of_memory_threads(void)
+{
+	unsigned failures = 0;
+
+	failures += test_threads_with_mask(0, 0);
+	/* 16 injected failures among the first 32 attempts, and none after,
+	 * although the attempts go well past the width of the mask */
+	failures += test_threads_with_mask(0xA5A5A5A5UL, 16);
+
+	return failures;
+}
+#else
+unsigned test_out_of_memory_threads(void)
+{
+	return 0;
+}
+#endif
+
+ECHECK_TEST_MAIN(test_out_of_memory_threads)